@@ -0,0 +1,122 @@
+// Times projecting quad bounds to screen space: the per-corner glm path the frame loop used to run,
+// the scalar SoA kernel and the SIMD SoA kernel, at a few board sizes.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+#include "screen_bounds.h"
+
+#define BENCH_WIDTH 1200
+#define BENCH_HEIGHT 900
+// Every case runs for at least this long so small boards aren't lost in timer noise.
+#define BENCH_MIN_SECONDS 0.2
+
+float random_float(float min, float max) {
+    return min + (max - min) * float(rand()) / float(RAND_MAX);
+}
+
+// What main_loop did per quad before the batch kernel: four corners through the view-projection,
+// divided by w, mapped to pixels and reduced to a rectangle.
+void project_corners_glm(const std::vector<glm::vec2>& centers,
+                         const std::vector<glm::vec2>& half_extents, const glm::mat4& view_proj,
+                         BoundsSoA& screen) {
+    uint32_t count = uint32_t(centers.size());
+    screen.min_x.resize(count);
+    screen.min_y.resize(count);
+    screen.max_x.resize(count);
+    screen.max_y.resize(count);
+    const glm::vec2 corners[4] = {glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f),
+                                  glm::vec2(-1.0f, 1.0f), glm::vec2(1.0f, 1.0f)};
+    for (uint32_t i = 0; i < count; i++) {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(centers[i], 0.0f));
+        model = glm::scale(model, glm::vec3(half_extents[i], 1.0f));
+        glm::mat4 mvp = view_proj * model;
+        glm::vec2 min = glm::vec2(1e30f);
+        glm::vec2 max = glm::vec2(-1e30f);
+        for (const glm::vec2& corner : corners) {
+            glm::vec4 clip = mvp * glm::vec4(corner.x, corner.y, 0.0f, 1.0f);
+            glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+            glm::vec2 pixel = (ndc + 1.0f) * 0.5f * glm::vec2(BENCH_WIDTH, BENCH_HEIGHT);
+            pixel.y = BENCH_HEIGHT - pixel.y;
+            min = glm::min(min, pixel);
+            max = glm::max(max, pixel);
+        }
+        screen.min_x[i] = min.x;
+        screen.min_y[i] = min.y;
+        screen.max_x[i] = max.x;
+        screen.max_y[i] = max.y;
+    }
+}
+
+template <typename F>
+double nanoseconds_per_quad(uint32_t count, F&& run) {
+    using clock = std::chrono::steady_clock;
+    uint32_t iterations = 0;
+    clock::time_point start = clock::now();
+    double elapsed = 0.0;
+    while (elapsed < BENCH_MIN_SECONDS) {
+        run();
+        iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    return elapsed * 1e9 / (double(iterations) * count);
+}
+
+float max_difference(const BoundsSoA& a, const BoundsSoA& b) {
+    float difference = 0.0f;
+    for (uint32_t i = 0; i < bounds_soa_size(a); i++) {
+        difference = glm::max(difference, glm::abs(a.min_x[i] - b.min_x[i]));
+        difference = glm::max(difference, glm::abs(a.min_y[i] - b.min_y[i]));
+        difference = glm::max(difference, glm::abs(a.max_x[i] - b.max_x[i]));
+        difference = glm::max(difference, glm::abs(a.max_y[i] - b.max_y[i]));
+    }
+    return difference;
+}
+
+int main() {
+    float aspect_ratio = float(BENCH_WIDTH) / float(BENCH_HEIGHT);
+    float zoom = 3.0f;
+    glm::mat4 proj =
+        glm::ortho(-aspect_ratio * zoom, aspect_ratio * zoom, -zoom, zoom, 0.0f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+                                 glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 view_proj = proj * view;
+    ScreenTransform transform = screen_transform(view_proj, BENCH_WIDTH, BENCH_HEIGHT);
+
+    printf("lanes: %d\n", SCREEN_BOUNDS_LANES);
+    printf("%8s %14s %14s %14s %10s\n", "quads", "glm ns/quad", "scalar ns/quad", "simd ns/quad",
+           "max diff");
+
+    const uint32_t counts[] = {1000, 10000, 100000};
+    for (uint32_t count : counts) {
+        srand(count);
+        std::vector<glm::vec2> centers(count);
+        std::vector<glm::vec2> half_extents(count);
+        BoundsSoA world;
+        for (uint32_t i = 0; i < count; i++) {
+            centers[i] = glm::vec2(random_float(-10.0f, 10.0f), random_float(-10.0f, 10.0f));
+            half_extents[i] = glm::vec2(random_float(0.1f, 2.0f), random_float(0.1f, 2.0f));
+            bounds_soa_push(world, centers[i] - half_extents[i], centers[i] + half_extents[i]);
+        }
+
+        BoundsSoA by_corners, by_scalar, by_simd;
+        double corners_ns = nanoseconds_per_quad(count, [&]() {
+            project_corners_glm(centers, half_extents, view_proj, by_corners);
+        });
+        double scalar_ns = nanoseconds_per_quad(
+            count, [&]() { screen_bounds_project_scalar(world, transform, by_scalar); });
+        double simd_ns = nanoseconds_per_quad(
+            count, [&]() { screen_bounds_project(world, transform, by_simd); });
+
+        float difference =
+            glm::max(max_difference(by_corners, by_simd), max_difference(by_scalar, by_simd));
+        printf("%8u %14.3f %14.3f %14.3f %10.5f\n", count, corners_ns, scalar_ns, simd_ns,
+               difference);
+    }
+    return 0;
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef EMSCRIPTEN
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "board_file.h"
+
+// The autosave of the board at path is a snapshot, a board file at path.autosave, followed by a
+// journal of the edits made since, at path.journal. Edits only cost the main thread a record
+// pushed onto a queue; a writer thread appends them and syncs once per batch. The web build has
+// no threads and writes the batches from the frame loop instead. Both files are deleted on a clean
+// exit with nothing left unsaved. Finding them on startup means the last session crashed or quit
+// with edits the board file doesn't have.
+#define AUTOSAVE_JOURNAL_MAGIC "BOARDJNL"
+// Longest an edit waits in memory before it is on disk.
+#define AUTOSAVE_SYNC_INTERVAL_SECONDS 0.25
+// Records after which the journal is folded into a new snapshot, 24 bytes each.
+#define AUTOSAVE_COMPACT_RECORDS 65536
+#define AUTOSAVE_NO_QUAD UINT32_MAX
+
+enum AutosaveOp : uint32_t {
+    // x and y are the new position.
+    AUTOSAVE_MOVE,
+    // value holds the BOARD_FILE_MIRROR_* flags the quad has now.
+    AUTOSAVE_MIRROR,
+    // value is the id of the quad now directly below, AUTOSAVE_NO_QUAD at the bottom.
+    AUTOSAVE_Z_ORDER,
+    AUTOSAVE_DELETE,
+    // A delete was undone.
+    AUTOSAVE_RESTORE,
+};
+
+// One edit, as the state the quad is left in, so replaying a record twice does no harm. Quads are
+// named by their board file id.
+struct AutosaveRecord {
+    uint32_t op;
+    uint32_t quad;
+    float x = 0.0f;
+    float y = 0.0f;
+    uint32_t value = 0;
+    // Hash of the fields above, a record torn by a crash fails it and ends the replay.
+    uint32_t check = 0;
+};
+static_assert(sizeof(AutosaveRecord) == 24, "autosave record layout changed");
+
+struct AutosaveJournalHeader {
+    char magic[8];
+    // Revision of the snapshot the records continue from.
+    uint64_t revision;
+};
+
+struct Autosave {
+    std::string snapshot_path;
+    std::string journal_path;
+    // Revision of the last snapshot handed to the writer.
+    uint64_t revision = 0;
+    // Records pushed since that snapshot, to know when to compact.
+    size_t records_since_snapshot = 0;
+
+    // Handed over from the main thread. Records before snapshot_at were made before the snapshot
+    // was taken and still go to the old journal, in case the snapshot can't be written.
+    std::vector<AutosaveRecord> pending;
+    bool snapshot_pending = false;
+    BoardFileWriter snapshot;
+    size_t snapshot_at = 0;
+    // Embedded images of the snapshot's quads, blob offsets point in here until the writer copies
+    // them. The main thread keeps this mapped until autosave_flush returns.
+    const uint8_t* snapshot_blobs = nullptr;
+    bool flush = false;
+
+    // Writer side.
+    FILE* journal = nullptr;
+    bool writing = false;
+#ifdef EMSCRIPTEN
+    double last_write = 0.0;
+#else
+    bool quit = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::thread thread;
+#endif
+};
+
+uint32_t autosave_record_check(const AutosaveRecord& record) {
+    // FNV-1a
+    const uint8_t* bytes = (const uint8_t*)&record;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(AutosaveRecord, check); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Starts a fresh journal continuing from the snapshot of the given revision.
+bool autosave_open_journal(Autosave& a, uint64_t revision) {
+    if (a.journal) fclose(a.journal);
+    a.journal = fopen(a.journal_path.c_str(), "wb");
+    AutosaveJournalHeader header = {};
+    memcpy(header.magic, AUTOSAVE_JOURNAL_MAGIC, sizeof(header.magic));
+    header.revision = revision;
+    if (!a.journal || fwrite(&header, sizeof(header), 1, a.journal) != 1 || !file_sync(a.journal)) {
+        printf("[error] couldn't start autosave journal %s\n", a.journal_path.c_str());
+        if (a.journal) fclose(a.journal);
+        a.journal = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void autosave_append(Autosave& a, const AutosaveRecord* records, size_t count) {
+    if (!a.journal || count == 0) return;
+    if (fwrite(records, sizeof(AutosaveRecord), count, a.journal) != count) {
+        printf("[error] couldn't append to autosave journal %s\n", a.journal_path.c_str());
+    }
+}
+
+// Writer side of one batch: the records made before the snapshot, the snapshot along with a new
+// journal, then the records made after it, and a single sync for all of them.
+void autosave_write_batch(Autosave& a, const std::vector<AutosaveRecord>& records,
+                          BoardFileWriter* snapshot, size_t snapshot_at, const uint8_t* blobs) {
+    size_t before = snapshot ? snapshot_at : 0;
+    autosave_append(a, records.data(), before);
+    if (snapshot) {
+        for (BoardFileQuad& quad : snapshot->quads) {
+            if (quad.blob_size > 0) {
+                board_file_writer_add_blob(*snapshot, quad, blobs + quad.blob_offset,
+                                           size_t(quad.blob_size));
+            }
+        }
+        // The old journal stays until the snapshot that replaces it is safely on disk.
+        if (board_file_write(*snapshot, a.snapshot_path.c_str())) {
+            autosave_open_journal(a, snapshot->revision);
+        }
+    }
+    autosave_append(a, records.data() + before, records.size() - before);
+    if (a.journal && !file_sync(a.journal)) {
+        printf("[error] couldn't sync autosave journal %s\n", a.journal_path.c_str());
+    }
+}
+
+#ifndef EMSCRIPTEN
+void autosave_run(Autosave* autosave) {
+    Autosave& a = *autosave;
+    std::unique_lock<std::mutex> lock(a.mutex);
+    std::vector<AutosaveRecord> records;
+    BoardFileWriter snapshot;
+    while (true) {
+        a.wake.wait(lock, [&]() { return a.quit || !a.pending.empty() || a.snapshot_pending; });
+        if (a.pending.empty() && !a.snapshot_pending) break;
+        // Edits made within the interval pile up and share one sync.
+        a.wake.wait_for(lock, std::chrono::duration<double>(AUTOSAVE_SYNC_INTERVAL_SECONDS),
+                        [&]() { return a.quit || a.flush; });
+
+        records.clear();
+        records.swap(a.pending);
+        bool has_snapshot = a.snapshot_pending;
+        size_t snapshot_at = a.snapshot_at;
+        const uint8_t* blobs = a.snapshot_blobs;
+        if (has_snapshot) snapshot = std::move(a.snapshot);
+        a.snapshot = BoardFileWriter{};
+        a.snapshot_pending = false;
+        a.writing = true;
+        lock.unlock();
+
+        autosave_write_batch(a, records, has_snapshot ? &snapshot : nullptr, snapshot_at, blobs);
+        snapshot = BoardFileWriter{};
+
+        lock.lock();
+        a.writing = false;
+        if (a.pending.empty() && !a.snapshot_pending) a.flush = false;
+        a.idle.notify_all();
+    }
+}
+#endif
+
+// Autosaves next to the board at board_path, the first thing handed over has to be a snapshot.
+void autosave_start(Autosave& a, const std::string& board_path) {
+    a.snapshot_path = board_path + ".autosave";
+    a.journal_path = board_path + ".journal";
+#ifndef EMSCRIPTEN
+    if (!a.thread.joinable()) a.thread = std::thread(autosave_run, &a);
+#endif
+}
+
+void autosave_push(Autosave& a, AutosaveRecord record) {
+    record.check = autosave_record_check(record);
+    a.records_since_snapshot++;
+#ifdef EMSCRIPTEN
+    a.pending.push_back(record);
+#else
+    std::lock_guard<std::mutex> lock(a.mutex);
+    a.pending.push_back(record);
+    a.wake.notify_one();
+#endif
+}
+
+// Hands over the whole board as the next snapshot, replacing one that wasn't written yet.
+void autosave_snapshot(Autosave& a, BoardFileWriter&& snapshot, const uint8_t* blobs) {
+    a.revision++;
+    a.records_since_snapshot = 0;
+    snapshot.revision = a.revision;
+#ifndef EMSCRIPTEN
+    std::lock_guard<std::mutex> lock(a.mutex);
+#endif
+    a.snapshot = std::move(snapshot);
+    a.snapshot_blobs = blobs;
+    a.snapshot_at = a.pending.size();
+    a.snapshot_pending = true;
+#ifndef EMSCRIPTEN
+    a.wake.notify_one();
+#endif
+}
+
+#ifdef EMSCRIPTEN
+// Writes what piled up once the sync interval has passed.
+void autosave_update(Autosave& a, double now) {
+    if ((a.pending.empty() && !a.snapshot_pending) ||
+        (!a.flush && now - a.last_write < AUTOSAVE_SYNC_INTERVAL_SECONDS)) {
+        return;
+    }
+    a.last_write = now;
+    a.flush = false;
+    autosave_write_batch(a, a.pending, a.snapshot_pending ? &a.snapshot : nullptr, a.snapshot_at,
+                         a.snapshot_blobs);
+    a.pending.clear();
+    a.snapshot = BoardFileWriter{};
+    a.snapshot_pending = false;
+}
+#endif
+
+// Returns once everything handed over is on disk, e.g. before the blobs of a snapshot are
+// unmapped.
+void autosave_flush(Autosave& a) {
+#ifdef EMSCRIPTEN
+    a.flush = true;
+    autosave_update(a, a.last_write);
+#else
+    std::unique_lock<std::mutex> lock(a.mutex);
+    a.flush = true;
+    a.wake.notify_one();
+    a.idle.wait(lock, [&]() { return a.pending.empty() && !a.snapshot_pending && !a.writing; });
+#endif
+}
+
+void autosave_stop(Autosave& a) {
+#ifdef EMSCRIPTEN
+    autosave_flush(a);
+#else
+    {
+        std::lock_guard<std::mutex> lock(a.mutex);
+        a.quit = true;
+        a.wake.notify_one();
+    }
+    if (a.thread.joinable()) a.thread.join();
+#endif
+    if (a.journal) fclose(a.journal);
+    a.journal = nullptr;
+}
+
+// Deletes the snapshot and journal after autosave_stop, once nothing maps the snapshot any more.
+void autosave_discard(Autosave& a) {
+    remove(a.journal_path.c_str());
+    remove(a.snapshot_path.c_str());
+}
+
+// Reads the journal at path, returning the records up to the first torn one and the snapshot
+// revision they continue from. False when there is no journal to recover.
+bool autosave_read_journal(const char* path, uint64_t& revision,
+                           std::vector<AutosaveRecord>& records) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    AutosaveJournalHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, AUTOSAVE_JOURNAL_MAGIC, sizeof(header.magic)) == 0;
+    records.clear();
+    AutosaveRecord record;
+    while (valid && fread(&record, sizeof(record), 1, file) == 1 &&
+           record.check == autosave_record_check(record)) {
+        records.push_back(record);
+    }
+    fclose(file);
+    revision = valid ? header.revision : 0;
+    return valid;
+}
@@ -0,0 +1,303 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if PLATFORM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Board files are laid out as header, quad table, string table and blob section, each starting on
+// an 8 byte boundary. Everything is little-endian and fixed size, so an open board is the mapped
+// file itself: the quad table is read in place and nothing is parsed or copied.
+#define BOARD_FILE_MAGIC "BOARDTHG"
+#define BOARD_FILE_VERSION 2
+#define BOARD_FILE_ALIGN 8
+#define BOARD_FILE_NO_STRING UINT32_MAX
+
+#define BOARD_FILE_MIRROR_H (1 << 0)
+#define BOARD_FILE_MIRROR_V (1 << 1)
+// Only autosave snapshots hold hidden quads, a delete that can still be undone.
+#define BOARD_FILE_HIDDEN (1 << 2)
+
+struct BoardFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t quad_count;
+    uint64_t quads_offset;
+    uint64_t strings_offset;
+    uint64_t strings_size;
+    uint64_t blobs_offset;
+    uint64_t blobs_size;
+    // Bumped by every autosave snapshot, the autosave journal names the revision it continues.
+    uint64_t revision;
+};
+static_assert(sizeof(BoardFileHeader) == 64, "board file header layout changed");
+
+// One quad, bottom of the stacking order first. The image size is stored so the board can be laid
+// out before any image is decoded.
+struct BoardFileQuad {
+    float position[2];
+    float scale[2];
+    uint32_t width;
+    uint32_t height;
+    uint32_t flags;
+    // Offset of the image path in the string table.
+    uint32_t path;
+    // Stays with the quad across saves and sessions, the autosave journal refers to quads by it.
+    uint32_t id;
+    // Average colour of the image as RGBA8 for placeholders, 0 until it was decoded once.
+    uint32_t color;
+    // Encoded image embedded in the blob section, blob_size is 0 when only the path is stored.
+    uint64_t blob_offset;
+    uint64_t blob_size;
+};
+static_assert(sizeof(BoardFileQuad) == 56, "board file quad layout changed");
+
+struct BoardFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const BoardFileHeader* header = nullptr;
+    const BoardFileQuad* quads = nullptr;
+    const char* strings = nullptr;
+    const uint8_t* blobs = nullptr;
+#if PLATFORM_WINDOWS
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+};
+
+void board_file_close(BoardFile& bf) {
+    if (bf.data) {
+#if PLATFORM_WINDOWS
+        UnmapViewOfFile(bf.data);
+        CloseHandle(bf.mapping);
+        CloseHandle(bf.file);
+#else
+        munmap((void*)bf.data, bf.size);
+#endif
+    }
+    bf = BoardFile{};
+}
+
+bool board_file_section_valid(const BoardFile& bf, uint64_t offset, uint64_t size) {
+    return offset % BOARD_FILE_ALIGN == 0 && offset <= bf.size && size <= bf.size - offset;
+}
+
+// Checks the tables against the file size once, so the quad table can be trusted afterwards.
+bool board_file_validate(BoardFile& bf, const char* path) {
+    if (bf.size < sizeof(BoardFileHeader)) {
+        printf("[error] %s is too small to be a board\n", path);
+        return false;
+    }
+    const BoardFileHeader& header = *(const BoardFileHeader*)bf.data;
+    if (memcmp(header.magic, BOARD_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        printf("[error] %s is not a board\n", path);
+        return false;
+    }
+    if (header.version != BOARD_FILE_VERSION) {
+        printf("[error] %s is board version %u, expected %u\n", path, header.version,
+               BOARD_FILE_VERSION);
+        return false;
+    }
+    if (!board_file_section_valid(bf, header.quads_offset,
+                                  uint64_t(header.quad_count) * sizeof(BoardFileQuad)) ||
+        !board_file_section_valid(bf, header.strings_offset, header.strings_size) ||
+        !board_file_section_valid(bf, header.blobs_offset, header.blobs_size) ||
+        (header.strings_size > 0 && bf.data[header.strings_offset + header.strings_size - 1])) {
+        printf("[error] %s is truncated or corrupt\n", path);
+        return false;
+    }
+
+    bf.header = &header;
+    bf.quads = (const BoardFileQuad*)(bf.data + header.quads_offset);
+    bf.strings = (const char*)(bf.data + header.strings_offset);
+    bf.blobs = bf.data + header.blobs_offset;
+    for (uint32_t i = 0; i < header.quad_count; i++) {
+        const BoardFileQuad& quad = bf.quads[i];
+        if ((quad.path != BOARD_FILE_NO_STRING && quad.path >= header.strings_size) ||
+            quad.blob_offset > header.blobs_size ||
+            quad.blob_size > header.blobs_size - quad.blob_offset) {
+            printf("[error] quad %u of %s points outside the file\n", i, path);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Maps the file and checks it, the board stays mapped until board_file_close.
+bool board_file_open(BoardFile& bf, const char* path) {
+    board_file_close(bf);
+
+#if PLATFORM_WINDOWS
+    // Sharing delete lets a save move the mapped file aside, see board_file_replace.
+    bf.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (bf.file == INVALID_HANDLE_VALUE || !GetFileSizeEx(bf.file, &size) || size.QuadPart == 0) {
+        printf("[error] couldn't open board %s\n", path);
+        if (bf.file != INVALID_HANDLE_VALUE) CloseHandle(bf.file);
+        bf = BoardFile{};
+        return false;
+    }
+    bf.mapping = CreateFileMappingA(bf.file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* data = bf.mapping ? MapViewOfFile(bf.mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data) {
+        printf("[error] couldn't map board %s\n", path);
+        if (bf.mapping) CloseHandle(bf.mapping);
+        CloseHandle(bf.file);
+        bf = BoardFile{};
+        return false;
+    }
+    bf.size = size_t(size.QuadPart);
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        printf("[error] couldn't open board %s\n", path);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive on its own.
+    close(fd);
+    if (data == MAP_FAILED) {
+        printf("[error] couldn't map board %s\n", path);
+        return false;
+    }
+    bf.size = size_t(st.st_size);
+#endif
+    bf.data = (const uint8_t*)data;
+
+    if (!board_file_validate(bf, path)) {
+        board_file_close(bf);
+        return false;
+    }
+    return true;
+}
+
+const char* board_file_string(const BoardFile& bf, uint32_t offset) {
+    return offset == BOARD_FILE_NO_STRING ? "" : bf.strings + offset;
+}
+
+uint64_t board_file_aligned(uint64_t offset) {
+    return (offset + BOARD_FILE_ALIGN - 1) / BOARD_FILE_ALIGN * BOARD_FILE_ALIGN;
+}
+
+// Board being built for saving, written out in one go by board_file_write.
+struct BoardFileWriter {
+    std::vector<BoardFileQuad> quads;
+    std::vector<char> strings;
+    std::vector<uint8_t> blobs;
+    uint64_t revision = 0;
+    // Strings already in the table, quads showing the same file share its path.
+    std::unordered_map<std::string, uint32_t> string_offsets;
+};
+
+uint32_t board_file_writer_add_string(BoardFileWriter& w, const char* string) {
+    auto [found, inserted] = w.string_offsets.try_emplace(string, uint32_t(w.strings.size()));
+    if (inserted) w.strings.insert(w.strings.end(), string, string + strlen(string) + 1);
+    return found->second;
+}
+
+// Appends an encoded image to the blob section and points quad at it.
+void board_file_writer_add_blob(BoardFileWriter& w, BoardFileQuad& quad, const uint8_t* data,
+                                size_t size) {
+    w.blobs.resize(board_file_aligned(w.blobs.size()));
+    quad.blob_offset = w.blobs.size();
+    quad.blob_size = size;
+    w.blobs.insert(w.blobs.end(), data, data + size);
+}
+
+// Pushes what was written to file down to the disk, so it survives a crash or power loss.
+bool file_sync(FILE* file) {
+    if (fflush(file) != 0) return false;
+#if PLATFORM_WINDOWS
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Moves the file at temp_path over path in one step. Windows won't replace a file that is mapped,
+// the board that was opened from path usually is, but it lets it be renamed: it is moved aside to
+// path.old, where its mapping keeps reading it, and deleted by a later write once it is unmapped.
+bool board_file_replace(const char* temp_path, const char* path) {
+#if PLATFORM_WINDOWS
+    std::string old_path = std::string(path) + ".old";
+    DeleteFileA(old_path.c_str());
+    if (MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        return true;
+    }
+    if (!MoveFileExA(path, old_path.c_str(), MOVEFILE_WRITE_THROUGH)) return false;
+    if (!MoveFileExA(temp_path, path, MOVEFILE_WRITE_THROUGH)) {
+        MoveFileExA(old_path.c_str(), path, MOVEFILE_WRITE_THROUGH);
+        return false;
+    }
+    DeleteFileA(old_path.c_str());
+    return true;
+#else
+    return rename(temp_path, path) == 0;
+#endif
+}
+
+// Writes to a temporary file first and moves it over path, a board that is currently mapped is
+// never rewritten in place, and a crash leaves either the old or the new board.
+bool board_file_write(const BoardFileWriter& w, const char* path) {
+    BoardFileHeader header = {};
+    memcpy(header.magic, BOARD_FILE_MAGIC, sizeof(header.magic));
+    header.version = BOARD_FILE_VERSION;
+    header.quad_count = uint32_t(w.quads.size());
+    header.quads_offset = board_file_aligned(sizeof(BoardFileHeader));
+    header.strings_offset =
+        board_file_aligned(header.quads_offset + w.quads.size() * sizeof(BoardFileQuad));
+    header.strings_size = w.strings.size();
+    header.blobs_offset = board_file_aligned(header.strings_offset + header.strings_size);
+    header.blobs_size = w.blobs.size();
+    header.revision = w.revision;
+
+    std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        printf("[error] couldn't write board %s\n", temp_path.c_str());
+        return false;
+    }
+    const uint8_t padding[BOARD_FILE_ALIGN] = {};
+    auto write_at = [&](uint64_t offset, const void* data, size_t size) {
+        long position = ftell(file);
+        fwrite(padding, 1, size_t(offset - uint64_t(position)), file);
+        return fwrite(data, 1, size, file) == size;
+    };
+    bool written = write_at(0, &header, sizeof(header)) &&
+                   write_at(header.quads_offset, w.quads.data(),
+                            w.quads.size() * sizeof(BoardFileQuad)) &&
+                   write_at(header.strings_offset, w.strings.data(), w.strings.size()) &&
+                   write_at(header.blobs_offset, w.blobs.data(), w.blobs.size());
+    written = written && file_sync(file);
+    written = fclose(file) == 0 && written;
+    if (!written) {
+        printf("[error] couldn't write board %s\n", temp_path.c_str());
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    if (!board_file_replace(temp_path.c_str(), path)) {
+        printf("[error] couldn't replace board %s\n", path);
+        remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "board_file.h"
+
+// What is known about an image file without decoding it, kept in a sidecar index next to the
+// board so a board is laid out from it on the next load. An entry holds as long as the file's
+// size and modification time match.
+#define IMAGE_INDEX_MAGIC "BOARDIDX"
+#define IMAGE_INDEX_VERSION 1
+
+struct ImageMeta {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    // content_hash of the file, 0 until it was decoded once.
+    uint64_t hash = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // Average colour as RGBA8, 0 until it was decoded once.
+    uint32_t color = 0;
+    uint32_t path = 0;
+};
+static_assert(sizeof(ImageMeta) == 40, "image index entry layout changed");
+
+struct ImageIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t strings_size;
+};
+
+struct ImageIndex {
+    std::unordered_map<std::string, ImageMeta> entries;
+    bool dirty = false;
+};
+
+// Size and modification time of a file, false when it can't be found.
+bool file_stat(const char* path, uint64_t& size, int64_t& mtime) {
+#if PLATFORM_WINDOWS
+    struct _stat64 st;
+    if (_stat64(path, &st) != 0) return false;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+#endif
+    size = uint64_t(st.st_size);
+    mtime = int64_t(st.st_mtime);
+    return true;
+}
+
+// 64-bit FNV-1a over 8 byte words, then the tail bytes. Only used to tell files apart.
+uint64_t content_hash(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 1099511628211ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+bool read_file(const char* path, std::vector<uint8_t>& data) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data.resize(size > 0 ? size_t(size) : 0);
+    bool read = size > 0 && fread(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    return read;
+}
+
+// Whatever was last recorded for path. It may be stale, whether the file still has the recorded
+// size and modification time is up to the caller to check.
+const ImageMeta* image_index_find(const ImageIndex& index, const std::string& path) {
+    auto found = index.entries.find(path);
+    return found == index.entries.end() ? nullptr : &found->second;
+}
+
+void image_index_set(ImageIndex& index, const std::string& path, const ImageMeta& meta) {
+    index.entries[path] = meta;
+    index.dirty = true;
+}
+
+bool image_index_load(ImageIndex& index, const char* path) {
+    index.entries.clear();
+    index.dirty = false;
+    uint64_t file_size;
+    int64_t mtime;
+    if (!file_stat(path, file_size, mtime)) return false;
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    ImageIndexHeader header;
+    std::vector<ImageMeta> metas;
+    std::vector<char> strings;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, IMAGE_INDEX_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == IMAGE_INDEX_VERSION;
+    // The sizes in the header have to add up to the file's before anything is allocated for them.
+    valid = valid && header.strings_size <= file_size &&
+            sizeof(header) + uint64_t(header.count) * sizeof(ImageMeta) + header.strings_size ==
+                file_size;
+    if (valid) {
+        metas.resize(header.count);
+        strings.resize(size_t(header.strings_size));
+        valid = fread(metas.data(), sizeof(ImageMeta), metas.size(), file) == metas.size() &&
+                fread(strings.data(), 1, strings.size(), file) == strings.size() &&
+                (strings.empty() || strings.back() == 0);
+    }
+    fclose(file);
+    if (!valid) {
+        printf("[error] image index %s is corrupt, images are probed again\n", path);
+        return false;
+    }
+    for (const ImageMeta& meta : metas) {
+        if (meta.path < strings.size()) index.entries[strings.data() + meta.path] = meta;
+    }
+    return true;
+}
+
+// Written to a temporary file and moved over path with board_file_replace, so a crash leaves
+// either the old or the new index.
+bool image_index_save(ImageIndex& index, const char* path) {
+    std::vector<ImageMeta> metas;
+    std::vector<char> strings;
+    metas.reserve(index.entries.size());
+    for (const auto& [image_path, meta] : index.entries) {
+        metas.push_back(meta);
+        metas.back().path = uint32_t(strings.size());
+        const char* chars = image_path.c_str();
+        strings.insert(strings.end(), chars, chars + image_path.size() + 1);
+    }
+    ImageIndexHeader header = {};
+    memcpy(header.magic, IMAGE_INDEX_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_INDEX_VERSION;
+    header.count = uint32_t(metas.size());
+    header.strings_size = strings.size();
+
+    std::string temp_path = std::string(path) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    bool written = file && fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(metas.data(), sizeof(ImageMeta), metas.size(), file) == metas.size() &&
+                   fwrite(strings.data(), 1, strings.size(), file) == strings.size() &&
+                   file_sync(file);
+    if (file) written = fclose(file) == 0 && written;
+    if (!written || !board_file_replace(temp_path.c_str(), path)) {
+        printf("[error] couldn't write image index %s\n", path);
+        remove(temp_path.c_str());
+        return false;
+    }
+    index.dirty = false;
+    return true;
+}
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#ifndef EMSCRIPTEN
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "image_index.h"
+#include "misc/stb_image.h"
+#include "mipmaps.h"
+#include "slot_map.h"
+#include "texture_cache.h"
+#include "tiled_images.h"
+
+// Images are decoded and their mip chains built on a pool of worker threads, images too large for
+// that are split into tile pyramids there. Probes, which only read the file's header for its size,
+// jump the queue. Finished jobs are pushed onto a lock-free
+// stack the main thread empties once per frame, only the texture upload is left to it. Chains are
+// converted here to the format that fits the channels they use, compressed when asked for. They go
+// to the texture cache, an image seen before is read back from it instead of decoded. The web
+// build has no threads and decodes on the main thread within a time budget.
+#define IMAGE_LOADER_MAX_THREADS 8
+// Decoded images are reduced to fit this before their mip chain is built, most quads are shown far
+// smaller. The full resolution is only decoded once a quad is zoomed in on.
+#define IMAGE_LOADER_REDUCED_SIZE 1024
+
+struct ImageLoadJob {
+    Handle quad;
+    std::string filename;
+    // Encoded image in memory the main thread keeps alive, read instead of filename when blob_size
+    // isn't 0.
+    const uint8_t* blob = nullptr;
+    size_t blob_size = 0;
+    // Only the dimensions are read, and only when the file's size or modification time differ from
+    // the ones known.
+    bool probe = false;
+    uint64_t known_size = 0;
+    int64_t known_mtime = 0;
+    // Content hash of the file at the known size and modification time, 0 when it was never
+    // decoded. A file that still matches is looked up in the cache without reading it.
+    uint64_t known_hash = 0;
+    // Keep the decoded size instead of reducing it.
+    bool full_resolution = false;
+    // Formats to encode the chain in, copied from the main thread's setting.
+    TextureCompression compression;
+};
+
+struct ImageLoadResult {
+    ImageLoadResult* next = nullptr;
+    Handle quad;
+    bool probe = false;
+    // The file could be read, for a probe that its header could.
+    bool loaded = false;
+    // A probe found the file as it was known.
+    bool unchanged = false;
+    // Too large for one texture, built as a tiled image instead for tiled_images_add to take over.
+    bool tiled = false;
+    TiledImage tiled_image;
+    // Size of the mip chain's first level, and of the image as decoded. They differ when reduced
+    // is set, or for an embedded image larger than a texture.
+    int width = 0;
+    int height = 0;
+    int full_width = 0;
+    int full_height = 0;
+    bool reduced = false;
+    // The channels the uploads were encoded for.
+    TextureChannels channels = TEXTURE_CHANNELS_RGBA;
+    std::vector<uint8_t> mips;
+    std::vector<size_t> mip_offsets;
+    // Every level of the chain prepared for the texture pages in a format other than RGBA8, mips
+    // are empty then.
+    std::vector<TextureUpload> uploads;
+    // Average colour as RGBA8, the last mip level.
+    uint32_t color = 0;
+    // Of the file the image came from, for the image index. hash stays 0 for probes and tiles.
+    uint64_t file_size = 0;
+    int64_t file_mtime = 0;
+    uint64_t hash = 0;
+};
+
+struct ImageLoader {
+    // Largest side decoded whole, bigger images come back with tiled set.
+    int max_decoded_size = 0;
+    int reduced_size = IMAGE_LOADER_REDUCED_SIZE;
+    // Called from a worker after each finished load, e.g. to wake an idle frame loop.
+    void (*notify)() = nullptr;
+    // No cache when null.
+    TextureCache* cache = nullptr;
+    std::deque<ImageLoadJob> jobs;
+    // Queued or being decoded.
+    uint32_t in_flight = 0;
+    std::atomic<ImageLoadResult*> done{nullptr};
+#ifndef EMSCRIPTEN
+    bool quit = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<std::thread> threads;
+#endif
+};
+
+// Encodes every level of the chain for the texture pages in the job's format for the channels the
+// image uses, and drops the RGBA8 chain. channels is the count the image was decoded from. Where
+// the encoder fails the uncompressed format for the same channels is used.
+void image_loader_encode(const ImageLoadJob& job, ImageLoadResult& result, int channels) {
+    const TextureCompression& compression = job.compression;
+    TextureChannels used = texture_channels(result.mips.data(), result.width, result.height,
+                                            channels);
+    result.channels = used;
+    TextureUploadScratch scratch;
+    for (bgfx::TextureFormat::Enum format :
+         {compression.formats[used], compression.lossless_formats[used]}) {
+        if (format == bgfx::TextureFormat::RGBA8) return;
+        result.uploads.resize(result.mip_offsets.size());
+        bool encoded = true;
+        for (size_t level = 0; encoded && level < result.uploads.size(); level++) {
+            encoded = texture_pages_prepare(result.mips.data() + result.mip_offsets[level],
+                                            mip_level_size(result.width, int(level)),
+                                            mip_level_size(result.height, int(level)), format,
+                                            compression.quality, scratch, result.uploads[level]);
+        }
+        if (encoded) {
+            result.mips = {};
+            result.mip_offsets = {};
+            return;
+        }
+        result.uploads.clear();
+    }
+}
+
+void image_loader_write_cache(const ImageLoader& loader, const ImageLoadJob& job,
+                              const ImageLoadResult& result) {
+    if (!loader.cache) return;
+    texture_cache_write(*loader.cache, result.hash, job.full_resolution,
+                        TextureCacheHeader{.level_count = uint32_t(mip_level_count(result.width,
+                                                                                   result.height)),
+                                           .width = uint32_t(result.width),
+                                           .height = uint32_t(result.height),
+                                           .full_width = uint32_t(result.full_width),
+                                           .full_height = uint32_t(result.full_height),
+                                           .color = result.color,
+                                           .preset = job.compression.preset,
+                                           .channels = uint32_t(result.channels)},
+                        result.mips, result.uploads);
+}
+
+// Fills in result from the cached chain of the image with the given content hash. Chains too large
+// for a texture here, e.g. cached on another GPU, or in another format than the job's for the
+// image's channels, count as a miss. An RGBA8 chain cached with another preset is encoded now and
+// cached again.
+bool image_loader_read_cache(const ImageLoader& loader, const ImageLoadJob& job, uint64_t hash,
+                             ImageLoadResult& result) {
+    TextureCacheHeader header;
+    if (!loader.cache || !texture_cache_read(*loader.cache, hash, job.full_resolution, header,
+                                             result.mips, result.mip_offsets, result.uploads)) {
+        return false;
+    }
+    auto format = bgfx::TextureFormat::Enum(header.format);
+    bool encoded = format != bgfx::TextureFormat::RGBA8;
+    auto channels = TextureChannels(header.channels);
+    if (int(std::max(header.width, header.height)) > loader.max_decoded_size ||
+        header.channels >= TEXTURE_CHANNELS_COUNT ||
+        (encoded && !texture_compression_uses(job.compression, channels, format, header.preset))) {
+        result.mips.clear();
+        result.mip_offsets.clear();
+        result.uploads.clear();
+        return false;
+    }
+    result.loaded = true;
+    result.hash = hash;
+    result.width = int(header.width);
+    result.height = int(header.height);
+    result.full_width = int(header.full_width);
+    result.full_height = int(header.full_height);
+    result.reduced = !job.full_resolution &&
+                     (header.width != header.full_width || header.height != header.full_height);
+    result.color = header.color;
+    result.channels = channels;
+    if (!encoded && header.preset != job.compression.preset) {
+        image_loader_encode(job, result, 4);
+        if (!result.uploads.empty()) image_loader_write_cache(loader, job, result);
+    }
+    return true;
+}
+
+// Decodes a baseline JPEG straight at 1/2, 1/4 or 1/8 scale, the smallest that keeps its longer
+// side at least max_size, so the full resolution pixels never exist. Rows are stored bottom first
+// like stb_image does on the loader's threads. False when no scale applies or the JPEG isn't
+// baseline, stb_image decodes those whole.
+bool image_loader_decode_jpeg_scaled(const uint8_t* encoded, size_t size, int max_size,
+                                     std::vector<uint8_t>& pixels, int& width, int& height,
+                                     int& full_width, int& full_height, int& channels) {
+    if (size < 2 || encoded[0] != 0xFF || encoded[1] != 0xD8 ||
+        !stbi_info_from_memory(encoded, int(size), &full_width, &full_height, &channels)) {
+        return false;
+    }
+    int side = std::max(full_width, full_height);
+    int denominator = 1;
+    while (denominator < 8 && (side + denominator * 2 - 1) / (denominator * 2) >= max_size) {
+        denominator *= 2;
+    }
+    if (denominator == 1) return false;
+
+    JpegRowDecoder jpeg;
+    if (!jpeg_rows_open_memory(jpeg, encoded, size, denominator)) return false;
+    width = jpeg.width;
+    height = jpeg.height;
+    channels = jpeg.component_count;
+    pixels.resize(size_t(width) * height * 4);
+    for (int y = height - 1; y >= 0; y--) {
+        if (!jpeg_rows_read(jpeg, pixels.data() + size_t(y) * width * 4)) {
+            pixels.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void image_loader_decode(const ImageLoader& loader, const ImageLoadJob& job,
+                         ImageLoadResult& result) {
+    result.quad = job.quad;
+    result.probe = job.probe;
+    // Embedded images can't be tiled, one larger than a texture is reduced to fit even at full
+    // resolution, and that is as sharp as it gets.
+    int max_size = job.full_resolution ? loader.max_decoded_size : loader.reduced_size;
+    int width, height, full_width, full_height, channels;
+    unsigned char* data = nullptr;
+    std::vector<uint8_t> scaled;
+    if (job.blob_size > 0) {
+        result.hash = content_hash(job.blob, job.blob_size);
+        if (image_loader_read_cache(loader, job, result.hash, result)) return;
+        if (!image_loader_decode_jpeg_scaled(job.blob, job.blob_size, max_size, scaled, width,
+                                             height, full_width, full_height, channels)) {
+            data = stbi_load_from_memory(job.blob, int(job.blob_size), &width, &height,
+                                         &channels, 4);
+        }
+    } else {
+        const char* filename = job.filename.c_str();
+        if (!file_stat(filename, result.file_size, result.file_mtime)) return;
+        bool unchanged = result.file_size == job.known_size && result.file_mtime == job.known_mtime;
+        if (job.probe && unchanged) {
+            result.loaded = true;
+            result.unchanged = true;
+            return;
+        }
+        if (!job.probe && unchanged && job.known_hash != 0 &&
+            image_loader_read_cache(loader, job, job.known_hash, result)) {
+            return;
+        }
+        bool known = stbi_info(filename, &width, &height, &channels);
+        if (job.probe || (known && std::max(width, height) > loader.max_decoded_size)) {
+            result.loaded = known;
+            result.width = result.full_width = width;
+            result.height = result.full_height = height;
+            if (!job.probe) {
+                result.tiled = true;
+                result.loaded = tiled_image_build(result.tiled_image, filename);
+            }
+            return;
+        }
+        // Read whole so the hash comes from the bytes that are decoded.
+        std::vector<uint8_t> encoded;
+        if (!read_file(filename, encoded)) return;
+        result.hash = content_hash(encoded.data(), encoded.size());
+        // The same image may be cached under another path, or the file was touched but not
+        // changed.
+        if (result.hash != job.known_hash &&
+            image_loader_read_cache(loader, job, result.hash, result)) {
+            return;
+        }
+        if (!image_loader_decode_jpeg_scaled(encoded.data(), encoded.size(), max_size, scaled,
+                                             width, height, full_width, full_height, channels)) {
+            data = stbi_load_from_memory(encoded.data(), int(encoded.size()), &width, &height,
+                                         &channels, 4);
+        }
+    }
+    if (!data && scaled.empty()) return;
+    result.full_width = data ? width : full_width;
+    result.full_height = data ? height : full_height;
+
+    // Other formats can't be decoded at a reduced scale, their decoded pixels are halved right
+    // away instead and only the reduced image is kept.
+    const uint8_t* pixels = data ? data : scaled.data();
+    std::vector<uint8_t> reduced;
+    if (!data && !job.full_resolution) result.reduced = true;
+    if (mip_reduce_to_fit(pixels, width, height, max_size, reduced) > 0) {
+        stbi_image_free(data);
+        data = nullptr;
+        pixels = reduced.data();
+        result.reduced = !job.full_resolution;
+    }
+    int level_count = mip_level_count(width, height);
+    mip_build_chain(pixels, width, height, level_count, result.mips, result.mip_offsets);
+    if (data) stbi_image_free(data);
+    memcpy(&result.color, result.mips.data() + result.mip_offsets[level_count - 1], 4);
+    result.loaded = true;
+    result.width = width;
+    result.height = height;
+    image_loader_encode(job, result, channels);
+    image_loader_write_cache(loader, job, result);
+}
+
+// Deletes a result along with a tiled image nobody took over.
+void image_loader_delete_result(ImageLoadResult* result) {
+    tiled_image_close(result->tiled_image);
+    delete result;
+}
+
+void image_loader_finish(ImageLoader& loader, ImageLoadResult* result) {
+    result->next = loader.done.load(std::memory_order_relaxed);
+    while (!loader.done.compare_exchange_weak(result->next, result, std::memory_order_release,
+                                              std::memory_order_relaxed)) {
+    }
+}
+
+#ifndef EMSCRIPTEN
+void image_loader_run(ImageLoader* image_loader) {
+    ImageLoader& loader = *image_loader;
+    // Quads are drawn bottom up. The flag is per thread, tiled_image_build only changes its own.
+    stbi_set_flip_vertically_on_load_thread(true);
+    std::unique_lock<std::mutex> lock(loader.mutex);
+    while (true) {
+        loader.wake.wait(lock, [&]() { return loader.quit || !loader.jobs.empty(); });
+        if (loader.quit) break;
+        ImageLoadJob job = std::move(loader.jobs.front());
+        loader.jobs.pop_front();
+        lock.unlock();
+
+        ImageLoadResult* result = new ImageLoadResult();
+        image_loader_decode(loader, job, *result);
+        image_loader_finish(loader, result);
+        if (loader.notify) loader.notify();
+
+        lock.lock();
+        loader.in_flight--;
+        if (loader.in_flight == 0) loader.idle.notify_all();
+    }
+}
+#endif
+
+void image_loader_start(ImageLoader& loader, int max_decoded_size, void (*notify)()) {
+    loader.max_decoded_size = max_decoded_size;
+    loader.notify = notify;
+#ifndef EMSCRIPTEN
+    // One core is left to the frame loop.
+    int count = std::clamp(int(std::thread::hardware_concurrency()) - 1, 1,
+                           IMAGE_LOADER_MAX_THREADS);
+    for (int i = 0; i < count; i++) {
+        loader.threads.emplace_back(image_loader_run, &loader);
+    }
+#endif
+}
+
+void image_loader_push(ImageLoader& loader, ImageLoadJob&& job) {
+#ifndef EMSCRIPTEN
+    std::lock_guard<std::mutex> lock(loader.mutex);
+#endif
+    if (job.probe) {
+        loader.jobs.push_front(std::move(job));
+    } else {
+        loader.jobs.push_back(std::move(job));
+    }
+    loader.in_flight++;
+#ifndef EMSCRIPTEN
+    loader.wake.notify_one();
+#endif
+}
+
+// Loads finished since the last call, as a list linked through next. The caller deletes them with
+// image_loader_delete_result.
+ImageLoadResult* image_loader_take(ImageLoader& loader) {
+    return loader.done.exchange(nullptr, std::memory_order_acquire);
+}
+
+// Whether the main thread has anything to pick up: finished loads, or on the web jobs to decode.
+bool image_loader_pending(const ImageLoader& loader) {
+    if (loader.done.load(std::memory_order_relaxed)) return true;
+#ifdef EMSCRIPTEN
+    return !loader.jobs.empty();
+#else
+    return false;
+#endif
+}
+
+#ifdef EMSCRIPTEN
+// Decodes queued jobs on the calling thread until budget_seconds are spent, at least one.
+void image_loader_update(ImageLoader& loader, double budget_seconds, double (*now)()) {
+    stbi_set_flip_vertically_on_load_thread(true);
+    double start = now();
+    bool first = true;
+    while (!loader.jobs.empty() && (first || now() - start < budget_seconds)) {
+        first = false;
+        ImageLoadResult* result = new ImageLoadResult();
+        image_loader_decode(loader, loader.jobs.front(), *result);
+        loader.jobs.pop_front();
+        loader.in_flight--;
+        image_loader_finish(loader, result);
+    }
+}
+#endif
+
+// Drops the queued jobs, waits for the ones being decoded and throws away every result, e.g.
+// before the memory the blobs point into goes away.
+void image_loader_cancel(ImageLoader& loader) {
+#ifndef EMSCRIPTEN
+    std::unique_lock<std::mutex> lock(loader.mutex);
+    loader.in_flight -= uint32_t(loader.jobs.size());
+    loader.jobs.clear();
+    loader.idle.wait(lock, [&]() { return loader.in_flight == 0; });
+#else
+    loader.in_flight = 0;
+    loader.jobs.clear();
+#endif
+    for (ImageLoadResult* result = image_loader_take(loader); result;) {
+        ImageLoadResult* next = result->next;
+        image_loader_delete_result(result);
+        result = next;
+    }
+}
+
+void image_loader_stop(ImageLoader& loader) {
+    image_loader_cancel(loader);
+#ifndef EMSCRIPTEN
+    {
+        std::lock_guard<std::mutex> lock(loader.mutex);
+        loader.quit = true;
+        loader.wake.notify_all();
+    }
+    for (std::thread& thread : loader.threads) {
+        thread.join();
+    }
+    loader.threads.clear();
+#endif
+}
@@ -1,12 +1,40 @@
+#include "autosave.h"
+#include "board_file.h"
+#include "image_index.h"
+#include "image_loader.h"
 #include "misc/misc.h"
 #include "quad_fragment.bin.h"
+#include "quad_instanced_vertex.bin.h"
 #include "quad_vertex.bin.h"
+#include "residency.h"
+#include "screen_bounds.h"
+#include "slot_map.h"
+#include "spatial_index.h"
+#include "texture_cache.h"
+#include "texture_compression.h"
+#include "texture_pages.h"
+#include "tiled_images.h"
+#include "undo.h"
+#include "z_order.h"
 
 #define VIEW_RENDER 0
 #define VIEW_COPY_TO_FRAMEBUFFER 1
 #define VIEW_BLIT 2
 #define VIEW_IMGUI 3
 
+#define BOARD_DEFAULT_PATH "board.board"
+// Web builds decode on the main thread, this long per frame and at least one image.
+#define QUAD_LOAD_BUDGET_SECONDS 0.008
+
+// Frames still drawn after the last change, ImGui needs a couple to settle hover and active states.
+#define REDRAW_SETTLE_FRAMES 3
+
+// Side of the placeholder palette, 16 levels per channel make 65536 colours.
+#define PLACEHOLDER_PALETTE_SIZE 256
+#define PLACEHOLDER_BROKEN_SIZE 8
+// Grey, for images never decoded.
+#define PLACEHOLDER_DEFAULT_COLOR 0xff808080
+
 struct PosTexcoordVertex {
     float x, y, z;
     float u, v;
@@ -19,71 +47,1126 @@ const bgfx::VertexLayout PosTexcoordVertex::Layout{
         .add(bgfx::Attrib::Position, 3, bgfx::AttribType::Float)
         .add(bgfx::Attrib::TexCoord0, 2, bgfx::AttribType::Float)};
 
-struct Quad {
-    glm::vec3 position = glm::vec3(0, 0, 0);
-    glm::vec2 scale = glm::vec2(1, 1);
-    float aspect_ratio = 1.0;
+// Per-instance data consumed by quad_instanced_vertex, stride must be a multiple of 16 bytes.
+struct QuadInstance {
+    glm::vec4 position;
+    glm::vec4 scale;
+    glm::vec4 uv_rect;
+    // Part of the quad covered, in quad-local [-1, 1] coordinates. Tiled images draw one per tile.
+    glm::vec4 local_rect;
+};
+
+const uint64_t QUAD_RENDER_STATE =
+    BGFX_STATE_WRITE_RGB |
+    BGFX_STATE_BLEND_FUNC(BGFX_STATE_BLEND_SRC_ALPHA, BGFX_STATE_BLEND_INV_SRC_ALPHA) |
+    BGFX_STATE_BLEND_ALPHA;
+
+#define QUAD_MIRROR_H (1 << 0)
+#define QUAD_MIRROR_V (1 << 1)
+// The quad's image is a tiled image rather than a residency image.
+#define QUAD_TILED (1 << 2)
+// The quad was edited and waits in ctx.dirty_quads for its model matrix and bounds to be rebuilt.
+#define QUAD_DIRTY (1 << 3)
+// The quad is in ctx.selected_quads.
+#define QUAD_SELECTED (1 << 4)
+// The quad was deleted but an undo step may still bring it back. It keeps its slot, images and
+// place in the z order, and is left out of the spatial index so nothing draws or picks it.
+#define QUAD_HIDDEN (1 << 5)
+// The image isn't decoded yet, it is once the quad first comes into view.
+#define QUAD_UNLOADED (1 << 6)
+// The image is being decoded by ctx.image_loader, a placeholder is drawn meanwhile.
+#define QUAD_LOADING (1 << 7)
+// The image couldn't be read, the quad is drawn as broken.
+#define QUAD_BROKEN (1 << 8)
+// The image file's header is being probed for its size.
+#define QUAD_PROBING (1 << 9)
+// The image was reduced when decoded, it is decoded again at full resolution once zoomed in on.
+#define QUAD_REDUCED (1 << 10)
+
+// Per-quad metadata the frame loop never reads.
+struct QuadInfo {
     std::string filename;
+    // Saved with the board, the autosave journal refers to quads by it.
+    uint32_t id = 0;
+    // Average colour of the image as RGBA8, what its placeholder shows. 0 when not known yet.
+    uint32_t color = 0;
+    glm::vec2 scale = glm::vec2(1, 1);
     glm::vec2 texture_size = glm::vec2(0, 0);
-    bgfx::TextureHandle texture_handle;
-    glm::vec2 min_corner;
-    glm::vec2 max_corner;
-    bool mirror_h = false;
-    bool mirror_v = false;
-    bool deleted = false;
-    unsigned char* cpu_texture_data;
-    int texture_width;
-    int texture_height;
-    int z_index = 0;
+    // Encoded image inside the open board file, used instead of filename when blob_size isn't 0.
+    uint64_t blob_offset = 0;
+    uint64_t blob_size = 0;
+};
+
+// Quads by slot as parallel arrays. Render, cull and pick only stream through the hot arrays,
+// filenames and other cold metadata live apart in info.
+struct Quads {
+    std::vector<glm::vec2> positions;
+    // World-space half width and height, from the texture aspect ratio and the quad scale.
+    std::vector<glm::vec2> half_extents;
+    // Cached world transform of the unit quad, only rebuilt for dirty quads.
+    std::vector<glm::mat4> models;
+    std::vector<float> texture_widths;
+    // Residency image, or tiled image when QUAD_TILED is set.
+    std::vector<int> images;
+    std::vector<uint16_t> flags;
+    std::vector<QuadInfo> info;
 };
 
 struct Context {
     GLFWwindow* window;
     int window_width = 1200;
     int window_height = 900;
-    int hovered_quad = -1;
-    int selected_quad = -1;
+    Handle hovered_quad;
+    // Selected slots in no particular order, membership is the QUAD_SELECTED flag.
+    std::vector<uint32_t> selected_quads;
+    // Where each selected slot is in selected_quads, by slot, so it is removed in O(1).
+    std::vector<uint32_t> selected_indices;
+    // Union of the selected quads' bounds, recomputed when the board or the selection changed.
+    glm::vec2 selection_min;
+    glm::vec2 selection_max;
+    uint32_t selection_bounds_version = 0;
+    // A drag moves the whole selection. The cursor callback only records the offset, it is
+    // applied to every selected quad once per frame. Changing the selection ends the drag.
+    bool dragging = false;
+    bool drag_moved = false;
     glm::vec2 drag_start_mouse_pos;
-    glm::vec3 drag_start_quad_pos;
-    int dragged_quad = -1;
-
-    std::vector<Quad> quads;
+    glm::vec2 drag_offset;
+    std::vector<glm::vec2> drag_start_positions;
+    // Board file the quads were loaded from. It stays mapped, embedded images are decoded from it
+    // lazily.
+    BoardFile board_file;
+    std::string board_path = BOARD_DEFAULT_PATH;
+    bool embed_images = false;
+    ImageLoader image_loader;
+    // Mip chains of images decoded before, shared by every board.
+    TextureCache texture_cache;
+    // Formats images loaded from now on are encoded in.
+    TextureCompression texture_compression;
+    // Sizes and colours of the board's image files from earlier runs, saved next to the board.
+    ImageIndex image_index;
+    uint32_t next_quad_id = 1;
+    Autosave autosave;
+
+    UndoJournal undo;
+    // Pixels held by hidden quads for the undo journal, and how much of that is allowed.
+    size_t undo_payload_bytes = 0;
+    size_t undo_payload_budget_bytes = size_t(UNDO_DEFAULT_PAYLOAD_BUDGET_MB) << 20;
+    uint32_t hidden_quads = 0;
+    // Rubber band in world space, from the press to the cursor.
+    bool marquee = false;
+    glm::vec2 marquee_start;
+    glm::vec2 marquee_end;
+
+    // Quads are referred to by handle, ctx.quads is indexed by the handle's slot and never moves
+    // quads around, so handles and anything cached per slot survive reordering and deletion.
+    SlotMap quad_slots;
+    Quads quads;
+    // Stacking order of the quad slots, walked bottom to top to draw.
+    ZOrder z_order;
+    // World-space bounds of every quad by slot, for culling and picking.
+    SpatialIndex spatial_index;
+    std::vector<uint32_t> visible_quads;
+    // Bounds of the visible quads in drawing order, in world space and projected to the screen.
+    BoundsSoA visible_world_bounds;
+    BoundsSoA visible_screen_bounds;
+    std::vector<uint32_t> picked_quads;
+    // Quads edited since the last frame, see quad_mark_dirty.
+    std::vector<uint32_t> dirty_quads;
+    // Bumped by every edit that changes how the board looks: moves, mirrors, stacking order and
+    // deletions.
+    uint32_t board_version = 1;
+    // The board has edits its file on disk doesn't, restored from an autosave or made since it was
+    // loaded or saved. The autosave is kept on exit until they are saved.
+    bool board_modified = false;
 
     bool was_inside = false;
     float camera_zoom = 3.0;
+    // Bumped whenever the camera moves or zooms, the matrices and world rectangle below are only
+    // recomputed then.
+    uint32_t camera_version = 1;
+    uint32_t cached_camera_version = 0;
+    glm::mat4 proj;
+    glm::mat4 view_proj;
+    glm::mat4 inverse_view_proj;
+    glm::vec2 camera_min;
+    glm::vec2 camera_max;
 
     bool erase_mode = false;
     bool erasing = false;
 
+    // When false every quad gets its own submit, kept around to compare against the batched path.
+    bool instanced_rendering = true;
+    // Parts of the visible quads in drawing order, with the texture entry and slot of each.
+    std::vector<QuadInstance> instances;
+    std::vector<int> instance_entries;
+    std::vector<uint32_t> instance_slots;
+    // Versions the parts were built from. As long as none changed and no image is streaming, a
+    // frame submits the same parts again without culling or looking at a single quad.
+    uint32_t parts_camera_version = 0;
+    uint32_t parts_board_version = 0;
+    uint32_t parts_texture_version = 0;
+
     bgfx::VertexBufferHandle vertex_buffer_handle;
     bgfx::IndexBufferHandle index_buffer_handle;
     bgfx::ShaderHandle vertex_shader_handle;
     bgfx::ShaderHandle fragment_shader_handle;
     bgfx::ProgramHandle program;
-    bgfx::TextureHandle readback_texture_handle;
+    bgfx::ShaderHandle instanced_vertex_shader_handle;
+    bgfx::ProgramHandle instanced_program;
 
     glm::mat4 view;
     float aspect_ratio;
 
     bgfx::UniformHandle uniform_handle;
-
-    bgfx::TextureHandle render_texture_handle;
-    bgfx::FrameBufferHandle framebuffer_handle;
+    bgfx::UniformHandle uv_rect_uniform_handle;
+    bgfx::UniformHandle texture_page_uniform_handle;
+    TexturePages texture_pages;
+    Residency residency;
+    TiledImages tiled_images;
+    std::vector<TileDraw> tile_draws;
+    // Quads whose image isn't decoded are drawn in their average colour, picked from a palette
+    // entry, or as a checkerboard when the image is broken.
+    std::vector<uint8_t> placeholder_palette;
+    std::vector<uint8_t> broken_pixels;
+    int placeholder_entry = -1;
+    int broken_entry = -1;
+
+    // Offscreen target and readback texture only exist while a capture is in flight, the board is
+    // otherwise drawn straight to the backbuffer.
+    bgfx::TextureHandle render_texture_handle = BGFX_INVALID_HANDLE;
+    bgfx::FrameBufferHandle framebuffer_handle = BGFX_INVALID_HANDLE;
+    bgfx::TextureHandle readback_texture_handle = BGFX_INVALID_HANDLE;
 
     bool readback_next_frame = false;
     bool save_next_available_frame = false;
     uint32_t frame_when_readback_available = 0;
     bool show_saved_notification = false;
     std::vector<uint8_t> pixels;
+
+    int redraw_frames = REDRAW_SETTLE_FRAMES;
 };
 Context ctx;
 
+bool quad_alive(Handle handle) {
+    return slot_map_contains(ctx.quad_slots, handle);
+}
+
+// Handle of a slot in the stacking order, an invalid one for Z_ORDER_NONE.
+Handle quad_z_order_handle(uint32_t slot) {
+    return slot == Z_ORDER_NONE ? Handle{} : slot_map_handle(ctx.quad_slots, slot);
+}
+
+// Half extents with the mirror flags applied, what the quad's unit square is scaled by.
+glm::vec2 quad_model_scale(uint32_t slot) {
+    uint16_t flags = ctx.quads.flags[slot];
+    return ctx.quads.half_extents[slot] * glm::vec2(flags & QUAD_MIRROR_H ? -1.0f : 1.0f,
+                                                    flags & QUAD_MIRROR_V ? -1.0f : 1.0f);
+}
+
+// Has to be called whenever a quad's position, half extents or mirror flags change. The model
+// matrix and bounds are rebuilt once at the start of the next frame, however often it was edited.
+void quad_mark_dirty(uint32_t slot) {
+    if (!(ctx.quads.flags[slot] & QUAD_DIRTY)) {
+        ctx.quads.flags[slot] |= QUAD_DIRTY;
+        ctx.dirty_quads.push_back(slot);
+    }
+    ctx.board_version++;
+}
+
+void quads_update_dirty() {
+    for (uint32_t slot : ctx.dirty_quads) {
+        // Deleted quads have their flags cleared and are skipped.
+        if (!(ctx.quads.flags[slot] & QUAD_DIRTY)) continue;
+        ctx.quads.flags[slot] &= ~QUAD_DIRTY;
+
+        glm::vec2 position = ctx.quads.positions[slot];
+        glm::vec2 half_extents = ctx.quads.half_extents[slot];
+        glm::mat4 model = glm::translate(glm::mat4(1.0), glm::vec3(position, 0.0f));
+        ctx.quads.models[slot] = glm::scale(model, glm::vec3(quad_model_scale(slot), 1.0f));
+        if (ctx.quads.flags[slot] & QUAD_HIDDEN) continue;
+        spatial_index_update(ctx.spatial_index, slot, position - half_extents,
+                             position + half_extents);
+    }
+    ctx.dirty_quads.clear();
+}
+
+void quad_set_texture_size(uint32_t slot, glm::vec2 texture_size) {
+    QuadInfo& info = ctx.quads.info[slot];
+    info.texture_size = texture_size;
+    ctx.quads.texture_widths[slot] = texture_size.x;
+    ctx.quads.half_extents[slot] =
+        glm::vec2(texture_size.x / texture_size.y * info.scale.x, info.scale.y);
+    quad_mark_dirty(slot);
+}
+
+Handle quad_add(glm::vec2 position, const std::string& filename) {
+    Handle handle = slot_map_insert(ctx.quad_slots);
+    uint32_t capacity = slot_map_capacity(ctx.quad_slots);
+    ctx.quads.positions.resize(capacity);
+    ctx.quads.half_extents.resize(capacity);
+    ctx.quads.models.resize(capacity);
+    ctx.quads.texture_widths.resize(capacity);
+    ctx.quads.images.resize(capacity);
+    ctx.quads.flags.resize(capacity);
+    ctx.quads.info.resize(capacity);
+    ctx.selected_indices.resize(capacity);
+
+    uint32_t slot = handle.index;
+    ctx.quads.positions[slot] = position;
+    ctx.quads.info[slot] = QuadInfo{.filename = filename, .id = ctx.next_quad_id++};
+    ctx.quads.half_extents[slot] = ctx.quads.info[slot].scale;
+    ctx.quads.texture_widths[slot] = 0.0f;
+    ctx.quads.images[slot] = -1;
+    ctx.quads.flags[slot] = QUAD_UNLOADED;
+    z_order_bring_to_front(ctx.z_order, slot);
+    quad_mark_dirty(slot);
+    return handle;
+}
+
+// CPU pixels a quad holds on to, what keeping a deleted quad around for undo costs.
+size_t quad_payload_bytes(uint32_t slot) {
+    int image = ctx.quads.images[slot];
+    if ((ctx.quads.flags[slot] & QUAD_TILED) || image < 0) return 0;
+    return residency_image_bytes(ctx.residency.images[image]);
+}
+
+// Swaps slot out of ctx.selected_quads, the caller clears QUAD_SELECTED.
+void selection_erase(uint32_t slot) {
+    uint32_t index = ctx.selected_indices[slot];
+    uint32_t moved = ctx.selected_quads.back();
+    ctx.selected_quads[index] = moved;
+    ctx.selected_indices[moved] = index;
+    ctx.selected_quads.pop_back();
+}
+
+// Constant time apart from the spatial index. The CPU pixels of the image are freed right away,
+// its texture space and pages once the frame that may still draw it has been submitted.
+void quad_remove(Handle handle) {
+    if (!quad_alive(handle)) return;
+
+    uint32_t slot = handle.index;
+    if (ctx.quads.flags[slot] & QUAD_SELECTED) {
+        selection_erase(slot);
+        ctx.selection_bounds_version = 0;
+    }
+    if (ctx.quads.flags[slot] & QUAD_HIDDEN) {
+        ctx.undo_payload_bytes -= quad_payload_bytes(slot);
+        ctx.hidden_quads--;
+    }
+    int image = ctx.quads.images[slot];
+    if (ctx.quads.flags[slot] & QUAD_TILED) {
+        tiled_images_remove(ctx.tiled_images, image);
+    } else if (image >= 0) {
+        residency_remove(ctx.residency, ctx.texture_pages, image);
+    }
+    ctx.quads.images[slot] = -1;
+    ctx.quads.flags[slot] = 0;
+    ctx.quads.info[slot] = QuadInfo{};
+    z_order_unlink(ctx.z_order, slot);
+    spatial_index_remove(ctx.spatial_index, slot);
+    slot_map_remove(ctx.quad_slots, handle);
+    ctx.board_version++;
+}
+
+void selection_add(uint32_t slot) {
+    if (ctx.quads.flags[slot] & QUAD_SELECTED) return;
+    ctx.quads.flags[slot] |= QUAD_SELECTED;
+    ctx.selected_indices[slot] = uint32_t(ctx.selected_quads.size());
+    ctx.selected_quads.push_back(slot);
+    ctx.selection_bounds_version = 0;
+    ctx.dragging = false;
+}
+
+void selection_remove(uint32_t slot) {
+    if (!(ctx.quads.flags[slot] & QUAD_SELECTED)) return;
+    ctx.quads.flags[slot] &= ~QUAD_SELECTED;
+    selection_erase(slot);
+    ctx.selection_bounds_version = 0;
+    ctx.dragging = false;
+}
+
+void selection_clear() {
+    for (uint32_t slot : ctx.selected_quads) {
+        ctx.quads.flags[slot] &= ~QUAD_SELECTED;
+    }
+    ctx.selected_quads.clear();
+    ctx.selection_bounds_version = 0;
+    ctx.dragging = false;
+}
+
+// First quad at or above slot in the stacking order that isn't hidden.
+uint32_t z_order_shown_from(uint32_t slot) {
+    while (slot != Z_ORDER_NONE && (ctx.quads.flags[slot] & QUAD_HIDDEN)) {
+        slot = ctx.z_order.nodes[slot].above;
+    }
+    return slot;
+}
+
+// First quad at or below slot in the stacking order that isn't hidden.
+uint32_t z_order_shown_down_from(uint32_t slot) {
+    while (slot != Z_ORDER_NONE && (ctx.quads.flags[slot] & QUAD_HIDDEN)) {
+        slot = ctx.z_order.nodes[slot].below;
+    }
+    return slot;
+}
+
+void selection_select_all() {
+    for (uint32_t slot = z_order_shown_from(ctx.z_order.bottom); slot != Z_ORDER_NONE;
+         slot = z_order_shown_from(ctx.z_order.nodes[slot].above)) {
+        selection_add(slot);
+    }
+}
+
+// Adds every quad overlapping the world-space rectangle.
+void selection_select_rect(glm::vec2 min, glm::vec2 max) {
+    ctx.picked_quads.clear();
+    spatial_index_query(ctx.spatial_index, min, max, ctx.picked_quads);
+    for (uint32_t slot : ctx.picked_quads) {
+        selection_add(slot);
+    }
+}
+
+// Puts the selection in stacking order, bottom first, so bulk z moves keep the relative order of
+// the selected quads.
+void selection_sort_by_z() {
+    std::sort(ctx.selected_quads.begin(), ctx.selected_quads.end(),
+              [](uint32_t a, uint32_t b) { return z_order_is_above(ctx.z_order, b, a); });
+    for (uint32_t i = 0; i < ctx.selected_quads.size(); i++) {
+        ctx.selected_indices[ctx.selected_quads[i]] = i;
+    }
+}
+
+// Mirror flags as stored in board files and the autosave journal.
+uint32_t quad_board_file_mirror(uint32_t slot) {
+    uint16_t flags = ctx.quads.flags[slot];
+    return (flags & QUAD_MIRROR_H ? BOARD_FILE_MIRROR_H : 0) |
+           (flags & QUAD_MIRROR_V ? BOARD_FILE_MIRROR_V : 0);
+}
+
+// Queues the state an edit left its quad in for the autosave journal.
+void autosave_record(const UndoEntry& entry, bool forward) {
+    uint32_t slot = entry.quad.index;
+    AutosaveRecord record = {.op = AUTOSAVE_MOVE, .quad = ctx.quads.info[slot].id};
+    switch (entry.op) {
+        case UNDO_MOVE: {
+            glm::vec2 position = forward ? entry.to : entry.from;
+            record.x = position.x;
+            record.y = position.y;
+            break;
+        }
+        case UNDO_MIRROR:
+            record.op = AUTOSAVE_MIRROR;
+            record.value = quad_board_file_mirror(slot);
+            break;
+        case UNDO_Z_ORDER: {
+            // Where the quad ended up, which differs from the entry when its neighbour is gone.
+            uint32_t below = ctx.z_order.nodes[slot].below;
+            record.op = AUTOSAVE_Z_ORDER;
+            record.value = below == Z_ORDER_NONE ? AUTOSAVE_NO_QUAD : ctx.quads.info[below].id;
+            break;
+        }
+        case UNDO_DELETE:
+            record.op = forward ? AUTOSAVE_DELETE : AUTOSAVE_RESTORE;
+            break;
+    }
+    autosave_push(ctx.autosave, record);
+    ctx.board_modified = true;
+}
+
+// Every edit goes into both the undo journal and the autosave journal.
+void record_edit(const UndoEntry& entry) {
+    undo_push(ctx.undo, entry);
+    autosave_record(entry, true);
+}
+
+void selection_begin_drag(glm::vec2 mouse_pos) {
+    ctx.dragging = true;
+    ctx.drag_moved = false;
+    ctx.drag_offset = glm::vec2(0.0f, 0.0f);
+    ctx.drag_start_mouse_pos = mouse_pos;
+    ctx.drag_start_positions.resize(ctx.selected_quads.size());
+    for (size_t i = 0; i < ctx.selected_quads.size(); i++) {
+        ctx.drag_start_positions[i] = ctx.quads.positions[ctx.selected_quads[i]];
+    }
+}
+
+// Moves every selected quad by the drag offset in one pass over the positions, however many cursor
+// events arrived since the last frame.
+void selection_apply_drag() {
+    if (!ctx.drag_moved) return;
+    ctx.drag_moved = false;
+    for (size_t i = 0; i < ctx.selected_quads.size(); i++) {
+        uint32_t slot = ctx.selected_quads[i];
+        ctx.quads.positions[slot] = ctx.drag_start_positions[i] + ctx.drag_offset;
+        quad_mark_dirty(slot);
+    }
+}
+
+// The whole drag goes into the journal as one step, one move per quad from where it started.
+void selection_end_drag() {
+    ctx.dragging = false;
+    if (ctx.drag_offset == glm::vec2(0.0f, 0.0f)) return;
+
+    undo_begin_group(ctx.undo);
+    for (size_t i = 0; i < ctx.selected_quads.size(); i++) {
+        uint32_t slot = ctx.selected_quads[i];
+        record_edit(UndoEntry{.quad = slot_map_handle(ctx.quad_slots, slot),
+                              .op = UNDO_MOVE,
+                              .from = ctx.drag_start_positions[i],
+                              .to = ctx.drag_start_positions[i] + ctx.drag_offset});
+    }
+    undo_end_group(ctx.undo);
+}
+
+// Journals a drag still in progress before another edit lands on top of it, the quads stay where
+// the drag took them.
+void selection_finish_drag() {
+    if (!ctx.dragging) return;
+    selection_apply_drag();
+    selection_end_drag();
+}
+
+void selection_mirror(uint8_t mirror_flag) {
+    undo_begin_group(ctx.undo);
+    for (uint32_t slot : ctx.selected_quads) {
+        ctx.quads.flags[slot] ^= mirror_flag;
+        quad_mark_dirty(slot);
+        record_edit(UndoEntry{.quad = slot_map_handle(ctx.quad_slots, slot),
+                              .op = UNDO_MIRROR,
+                              .mirror = mirror_flag});
+    }
+    undo_end_group(ctx.undo);
+}
+
+// Journals a stacking change of slot, if it moved at all.
+void undo_push_z_order(uint32_t slot, uint32_t below_before) {
+    uint32_t below_after = ctx.z_order.nodes[slot].below;
+    if (below_after == below_before) return;
+    record_edit(UndoEntry{.quad = slot_map_handle(ctx.quad_slots, slot),
+                          .op = UNDO_Z_ORDER,
+                          .below_before = quad_z_order_handle(below_before),
+                          .below_after = quad_z_order_handle(below_after)});
+}
+
+// Raises each selected quad above its next unselected neighbour, a selected run moves as one.
+void selection_raise() {
+    selection_sort_by_z();
+    undo_begin_group(ctx.undo);
+    for (size_t i = ctx.selected_quads.size(); i-- > 0;) {
+        uint32_t slot = ctx.selected_quads[i];
+        uint32_t below_before = ctx.z_order.nodes[slot].below;
+        uint32_t above = z_order_shown_from(ctx.z_order.nodes[slot].above);
+        if (above != Z_ORDER_NONE && !(ctx.quads.flags[above] & QUAD_SELECTED)) {
+            z_order_insert_above(ctx.z_order, slot, above);
+            undo_push_z_order(slot, below_before);
+        }
+    }
+    undo_end_group(ctx.undo);
+    ctx.board_version++;
+}
+
+void selection_lower() {
+    selection_sort_by_z();
+    undo_begin_group(ctx.undo);
+    for (uint32_t slot : ctx.selected_quads) {
+        uint32_t below_before = ctx.z_order.nodes[slot].below;
+        uint32_t below = z_order_shown_down_from(below_before);
+        if (below != Z_ORDER_NONE && !(ctx.quads.flags[below] & QUAD_SELECTED)) {
+            z_order_insert_below(ctx.z_order, slot, below);
+            undo_push_z_order(slot, below_before);
+        }
+    }
+    undo_end_group(ctx.undo);
+    ctx.board_version++;
+}
+
+void selection_bring_to_front() {
+    selection_sort_by_z();
+    undo_begin_group(ctx.undo);
+    for (uint32_t slot : ctx.selected_quads) {
+        uint32_t below_before = ctx.z_order.nodes[slot].below;
+        z_order_bring_to_front(ctx.z_order, slot);
+        undo_push_z_order(slot, below_before);
+    }
+    undo_end_group(ctx.undo);
+    ctx.board_version++;
+}
+
+void selection_send_to_back() {
+    selection_sort_by_z();
+    undo_begin_group(ctx.undo);
+    for (size_t i = ctx.selected_quads.size(); i-- > 0;) {
+        uint32_t slot = ctx.selected_quads[i];
+        uint32_t below_before = ctx.z_order.nodes[slot].below;
+        z_order_send_to_back(ctx.z_order, slot);
+        undo_push_z_order(slot, below_before);
+    }
+    undo_end_group(ctx.undo);
+    ctx.board_version++;
+}
+
+void selection_update_bounds() {
+    if (ctx.selection_bounds_version == ctx.board_version) return;
+    ctx.selection_bounds_version = ctx.board_version;
+
+    if (ctx.selected_quads.empty()) return;
+    const SpatialItem& first = ctx.spatial_index.items[ctx.selected_quads[0]];
+    ctx.selection_min = first.min;
+    ctx.selection_max = first.max;
+    for (uint32_t slot : ctx.selected_quads) {
+        const SpatialItem& bounds = ctx.spatial_index.items[slot];
+        ctx.selection_min = glm::min(ctx.selection_min, bounds.min);
+        ctx.selection_max = glm::max(ctx.selection_max, bounds.max);
+    }
+}
+
+// Takes a quad off the board but keeps everything needed to put it back.
+void quad_hide(uint32_t slot) {
+    selection_remove(slot);
+    ctx.quads.flags[slot] |= QUAD_HIDDEN;
+    spatial_index_remove(ctx.spatial_index, slot);
+    ctx.undo_payload_bytes += quad_payload_bytes(slot);
+    ctx.hidden_quads++;
+    ctx.board_version++;
+}
+
+void quad_show(uint32_t slot) {
+    ctx.quads.flags[slot] &= ~QUAD_HIDDEN;
+    ctx.undo_payload_bytes -= quad_payload_bytes(slot);
+    ctx.hidden_quads--;
+    quad_mark_dirty(slot);
+}
+
+// Really deletes the quads whose delete can no longer be undone, and forgets the oldest steps while
+// the hidden quads still hold too many pixels. The pixels of a dropped step are only released by
+// removing its quads, so they go before the budget is checked again.
+void undo_release_dropped() {
+    do {
+        for (const UndoEntry& entry : ctx.undo.dropped) {
+            if (entry.op == UNDO_DELETE) quad_remove(entry.quad);
+        }
+        ctx.undo.dropped.clear();
+    } while (ctx.undo_payload_bytes > ctx.undo_payload_budget_bytes && undo_drop_oldest(ctx.undo));
+}
+
+// Deleted quads are only hidden, their slots and pixels are released once the delete drops out of
+// the journal.
+void selection_delete() {
+    if (ctx.selected_quads.empty()) return;
+    selection_finish_drag();
+    std::vector<uint32_t> slots;
+    slots.swap(ctx.selected_quads);
+    undo_begin_group(ctx.undo);
+    for (uint32_t slot : slots) {
+        ctx.quads.flags[slot] &= ~QUAD_SELECTED;
+        quad_hide(slot);
+        record_edit(UndoEntry{.quad = slot_map_handle(ctx.quad_slots, slot), .op = UNDO_DELETE});
+    }
+    undo_end_group(ctx.undo);
+    ctx.selection_bounds_version = 0;
+}
+
+void undo_apply(const UndoEntry& entry, bool forward) {
+    if (!quad_alive(entry.quad)) return;
+    uint32_t slot = entry.quad.index;
+    switch (entry.op) {
+        case UNDO_MOVE:
+            ctx.quads.positions[slot] = forward ? entry.to : entry.from;
+            quad_mark_dirty(slot);
+            break;
+        case UNDO_MIRROR:
+            ctx.quads.flags[slot] ^= entry.mirror;
+            quad_mark_dirty(slot);
+            break;
+        case UNDO_Z_ORDER: {
+            Handle below = forward ? entry.below_after : entry.below_before;
+            uint32_t below_slot = below.index;
+            // The quad it was above has been deleted for good since, it goes on top instead.
+            if (below_slot != Z_ORDER_NONE && !quad_alive(below)) below_slot = ctx.z_order.top;
+            z_order_insert_above(ctx.z_order, slot, below_slot);
+            ctx.board_version++;
+            break;
+        }
+        case UNDO_DELETE:
+            if (forward) {
+                quad_hide(slot);
+            } else {
+                quad_show(slot);
+            }
+            break;
+    }
+    autosave_record(entry, forward);
+}
+
+void undo() {
+    size_t begin, end;
+    selection_finish_drag();
+    if (!undo_step_back(ctx.undo, begin, end)) return;
+    for (size_t i = end; i-- > begin;) {
+        undo_apply(ctx.undo.entries[i], false);
+    }
+}
+
+void redo() {
+    size_t begin, end;
+    selection_finish_drag();
+    if (!undo_step_forward(ctx.undo, begin, end)) return;
+    for (size_t i = begin; i < end; i++) {
+        undo_apply(ctx.undo.entries[i], true);
+    }
+}
+
+// Hands a quad's image to the loader, the quad shows its placeholder or its reduced image until
+// the image is back.
+void quad_request_image(uint32_t slot, bool full_resolution = false) {
+    const QuadInfo& info = ctx.quads.info[slot];
+    ctx.quads.flags[slot] &= ~QUAD_UNLOADED;
+    ctx.quads.flags[slot] |= QUAD_LOADING;
+    const uint8_t* blob = info.blob_size > 0 ? ctx.board_file.blobs + info.blob_offset : nullptr;
+    ImageLoadJob job = {.quad = slot_map_handle(ctx.quad_slots, slot),
+                        .filename = info.filename,
+                        .blob = blob,
+                        .blob_size = size_t(info.blob_size),
+                        .full_resolution = full_resolution,
+                        .compression = ctx.texture_compression};
+    // A file decoded before is found in the texture cache by its indexed hash without reading it.
+    if (const ImageMeta* meta = image_index_find(ctx.image_index, info.filename)) {
+        job.known_size = meta->size;
+        job.known_mtime = meta->mtime;
+        job.known_hash = meta->hash;
+    }
+    image_loader_push(ctx.image_loader, std::move(job));
+}
+
+// Lays a quad out from the image index right away, and has the loader check the file's header in
+// case it changed since. Images embedded in the board never change and aren't probed.
+void quad_request_probe(uint32_t slot) {
+    QuadInfo& info = ctx.quads.info[slot];
+    if (info.blob_size > 0) return;
+    ImageLoadJob job = {.quad = slot_map_handle(ctx.quad_slots, slot),
+                        .filename = info.filename,
+                        .probe = true};
+    if (const ImageMeta* meta = image_index_find(ctx.image_index, info.filename)) {
+        if (meta->width > 0 && meta->height > 0) {
+            quad_set_texture_size(slot, glm::vec2(meta->width, meta->height));
+        }
+        if (meta->color != 0) info.color = meta->color;
+        job.known_size = meta->size;
+        job.known_mtime = meta->mtime;
+    }
+    ctx.quads.flags[slot] |= QUAD_PROBING;
+    image_loader_push(ctx.image_loader, std::move(job));
+}
+
+void quad_receive_probe(const ImageLoadResult& result) {
+    if (!quad_alive(result.quad)) return;
+    uint32_t slot = result.quad.index;
+    if (!(ctx.quads.flags[slot] & QUAD_PROBING)) return;
+    ctx.quads.flags[slot] &= ~QUAD_PROBING;
+    if (result.unchanged) return;
+
+    QuadInfo& info = ctx.quads.info[slot];
+    if (!result.loaded) {
+        // Not worth decoding either, the quad shows as broken before it even comes into view.
+        if (ctx.quads.flags[slot] & QUAD_UNLOADED) {
+            printf("[error] couldn't read %s\n", info.filename.c_str());
+            ctx.quads.flags[slot] &= ~QUAD_UNLOADED;
+            ctx.quads.flags[slot] |= QUAD_BROKEN;
+            ctx.board_version++;
+        }
+        return;
+    }
+    // The file changed since the quad was saved or indexed, unless it was decoded meanwhile its
+    // size and colour are stale.
+    if (ctx.quads.images[slot] < 0) {
+        info.color = 0;
+        quad_set_texture_size(slot, glm::vec2(result.width, result.height));
+    }
+    const ImageMeta* meta = image_index_find(ctx.image_index, info.filename);
+    if (!meta || meta->size != result.file_size || meta->mtime != result.file_mtime) {
+        image_index_set(ctx.image_index, info.filename,
+                        ImageMeta{.size = result.file_size,
+                                  .mtime = result.file_mtime,
+                                  .width = uint32_t(result.width),
+                                  .height = uint32_t(result.height)});
+    }
+}
+
+// Uploads a decoded image, or takes over the tiled image the loader built when it is larger than a
+// texture can hold.
+// A quad whose image can't be read is marked broken, the rest of the board is unaffected.
+void quad_receive_image(ImageLoadResult& result) {
+    // Deleted while loading, or the slot went to another quad.
+    if (!quad_alive(result.quad)) return;
+    uint32_t slot = result.quad.index;
+    if (!(ctx.quads.flags[slot] & QUAD_LOADING)) return;
+    ctx.quads.flags[slot] &= ~QUAD_LOADING;
+
+    const char* filename = ctx.quads.info[slot].filename.c_str();
+    if (result.loaded && ctx.quads.info[slot].blob_size == 0) {
+        image_index_set(ctx.image_index, filename,
+                        ImageMeta{.size = result.file_size,
+                                  .mtime = result.file_mtime,
+                                  .hash = result.hash,
+                                  .width = uint32_t(result.full_width),
+                                  .height = uint32_t(result.full_height),
+                                  .color = result.color});
+    }
+    if (result.tiled) {
+        if (result.loaded) {
+            ctx.quads.images[slot] =
+                tiled_images_add(ctx.tiled_images, ctx.texture_pages, result.tiled_image);
+            ctx.quads.flags[slot] |= QUAD_TILED;
+            quad_set_texture_size(slot, glm::vec2(result.width, result.height));
+            return;
+        }
+        printf("[error] couldn't tile %s\n", filename);
+    } else if (result.loaded) {
+        // A full resolution image replaces the reduced one, which stays drawn until now.
+        bool hidden = ctx.quads.flags[slot] & QUAD_HIDDEN;
+        if (hidden) ctx.undo_payload_bytes -= quad_payload_bytes(slot);
+        if (ctx.quads.images[slot] >= 0) {
+            residency_remove(ctx.residency, ctx.texture_pages, ctx.quads.images[slot]);
+        }
+        ctx.quads.images[slot] =
+            residency_add_chain(ctx.residency, ctx.texture_pages, std::move(result.mips),
+                                std::move(result.mip_offsets), std::move(result.uploads),
+                                result.width, result.height);
+        if (hidden) ctx.undo_payload_bytes += quad_payload_bytes(slot);
+        ctx.quads.info[slot].color = result.color;
+        if (result.reduced) {
+            ctx.quads.flags[slot] |= QUAD_REDUCED;
+        } else {
+            ctx.quads.flags[slot] &= ~QUAD_REDUCED;
+        }
+        // Laid out at the full size, detail is picked by the texels actually held.
+        quad_set_texture_size(slot, glm::vec2(result.full_width, result.full_height));
+        ctx.quads.texture_widths[slot] = float(result.width);
+        return;
+    } else {
+        printf("[error] couldn't load %s\n", filename);
+    }
+    // A full resolution decode that failed leaves the reduced image, it isn't tried again.
+    ctx.quads.flags[slot] &= ~QUAD_REDUCED;
+    if (ctx.quads.images[slot] >= 0) return;
+    ctx.quads.flags[slot] |= QUAD_BROKEN;
+    ctx.board_version++;
+}
+
+// Picks up the probes and images the loader finished since the last frame.
+void quads_receive_images() {
+#ifdef EMSCRIPTEN
+    image_loader_update(ctx.image_loader, QUAD_LOAD_BUDGET_SECONDS, glfwGetTime);
+#endif
+    for (ImageLoadResult* result = image_loader_take(ctx.image_loader); result;) {
+        ImageLoadResult* next = result->next;
+        if (result->probe) {
+            quad_receive_probe(*result);
+        } else {
+            quad_receive_image(*result);
+        }
+        image_loader_delete_result(result);
+        result = next;
+    }
+}
+
+// A quad's entry in a board file, without its image.
+BoardFileQuad board_file_quad(BoardFileWriter& writer, uint32_t slot) {
+    const QuadInfo& info = ctx.quads.info[slot];
+    glm::vec2 position = ctx.quads.positions[slot];
+    return BoardFileQuad{
+        .position = {position.x, position.y},
+        .scale = {info.scale.x, info.scale.y},
+        .width = uint32_t(info.texture_size.x),
+        .height = uint32_t(info.texture_size.y),
+        .flags = quad_board_file_mirror(slot) |
+                 (ctx.quads.flags[slot] & QUAD_HIDDEN ? BOARD_FILE_HIDDEN : 0),
+        .path = board_file_writer_add_string(writer, info.filename.c_str()),
+        .id = info.id,
+        .color = info.color};
+}
+
+// Writes the quads on the board bottom to top. Images that came embedded in the open board stay
+// embedded, with embed_images every other image file is copied into the board as well.
+bool board_save(const char* path, bool embed_images) {
+    BoardFileWriter writer;
+    std::vector<uint8_t> file_data;
+    for (uint32_t slot = z_order_shown_from(ctx.z_order.bottom); slot != Z_ORDER_NONE;
+         slot = z_order_shown_from(ctx.z_order.nodes[slot].above)) {
+        const QuadInfo& info = ctx.quads.info[slot];
+        BoardFileQuad quad = board_file_quad(writer, slot);
+        if (info.blob_size > 0) {
+            board_file_writer_add_blob(writer, quad, ctx.board_file.blobs + info.blob_offset,
+                                       info.blob_size);
+        } else if (embed_images) {
+            if (read_file(info.filename.c_str(), file_data)) {
+                board_file_writer_add_blob(writer, quad, file_data.data(), file_data.size());
+            } else {
+                printf("[error] couldn't embed %s, only its path is saved\n",
+                       info.filename.c_str());
+            }
+        }
+        writer.quads.push_back(quad);
+    }
+    return board_file_write(writer, path);
+}
+
+// Hands the board to the autosave writer as a new snapshot, which also starts a new journal. Hidden
+// quads go in too, their deletes may still be undone. Only the quad table is built here: embedded
+// images are copied from the mapped board, and everything is written, on the writer thread.
+void autosave_take_snapshot() {
+    BoardFileWriter writer;
+    writer.quads.reserve(ctx.z_order.count);
+    for (uint32_t slot = ctx.z_order.bottom; slot != Z_ORDER_NONE;
+         slot = ctx.z_order.nodes[slot].above) {
+        const QuadInfo& info = ctx.quads.info[slot];
+        BoardFileQuad quad = board_file_quad(writer, slot);
+        // Still relative to the open board's blobs.
+        quad.blob_offset = info.blob_offset;
+        quad.blob_size = info.blob_size;
+        writer.quads.push_back(quad);
+    }
+    autosave_snapshot(ctx.autosave, std::move(writer), ctx.board_file.blobs);
+}
+
+// Applies journaled edits on top of a freshly loaded snapshot.
+void autosave_replay(const std::vector<AutosaveRecord>& records) {
+    std::unordered_map<uint32_t, uint32_t> slots_by_id;
+    for (uint32_t slot = 0; slot < slot_map_capacity(ctx.quad_slots); slot++) {
+        if (ctx.quad_slots.alive[slot]) slots_by_id[ctx.quads.info[slot].id] = slot;
+    }
+    for (const AutosaveRecord& record : records) {
+        auto found = slots_by_id.find(record.quad);
+        if (found == slots_by_id.end()) continue;
+        uint32_t slot = found->second;
+        uint16_t& flags = ctx.quads.flags[slot];
+        switch (record.op) {
+            case AUTOSAVE_MOVE:
+                ctx.quads.positions[slot] = glm::vec2(record.x, record.y);
+                quad_mark_dirty(slot);
+                break;
+            case AUTOSAVE_MIRROR:
+                flags &= ~(QUAD_MIRROR_H | QUAD_MIRROR_V);
+                if (record.value & BOARD_FILE_MIRROR_H) flags |= QUAD_MIRROR_H;
+                if (record.value & BOARD_FILE_MIRROR_V) flags |= QUAD_MIRROR_V;
+                quad_mark_dirty(slot);
+                break;
+            case AUTOSAVE_Z_ORDER: {
+                uint32_t below = Z_ORDER_NONE;
+                if (record.value != AUTOSAVE_NO_QUAD) {
+                    auto found_below = slots_by_id.find(record.value);
+                    if (found_below == slots_by_id.end()) break;
+                    below = found_below->second;
+                }
+                z_order_insert_above(ctx.z_order, slot, below);
+                ctx.board_version++;
+                break;
+            }
+            case AUTOSAVE_DELETE:
+                if (!(flags & QUAD_HIDDEN)) quad_hide(slot);
+                break;
+            case AUTOSAVE_RESTORE:
+                if (flags & QUAD_HIDDEN) quad_show(slot);
+                break;
+        }
+    }
+}
+
+// Removes every quad, hidden ones included, along with the history that refers to them.
+void board_clear() {
+    selection_clear();
+    for (uint32_t slot = 0; slot < slot_map_capacity(ctx.quad_slots); slot++) {
+        if (ctx.quad_slots.alive[slot]) quad_remove(slot_map_handle(ctx.quad_slots, slot));
+    }
+    ctx.undo.entries.clear();
+    ctx.undo.cursor = 0;
+    ctx.undo.dropped.clear();
+    // Loads still running may read images out of the board file.
+    image_loader_cancel(ctx.image_loader);
+    ctx.dragging = false;
+    ctx.board_version++;
+}
+
+// Replaces the board with the one in the file, with the edits of an autosave journal applied when
+// restoring one. Only the quad table is walked, images are decoded once their quads come into
+// view. The loaded board becomes the autosave's new snapshot.
+bool board_load(const char* path, const std::vector<AutosaveRecord>* journal = nullptr) {
+    BoardFile board_file;
+    if (!board_file_open(board_file, path)) return false;
+    board_clear();
+    // A snapshot still being written may copy images out of the old board.
+    autosave_flush(ctx.autosave);
+    board_file_close(ctx.board_file);
+    ctx.board_file = board_file;
+
+    for (uint32_t i = 0; i < board_file.header->quad_count; i++) {
+        const BoardFileQuad& quad = board_file.quads[i];
+        Handle handle = quad_add(glm::vec2(quad.position[0], quad.position[1]),
+                                 board_file_string(board_file, quad.path));
+        uint32_t slot = handle.index;
+        QuadInfo& info = ctx.quads.info[slot];
+        info.id = quad.id;
+        info.color = quad.color;
+        ctx.next_quad_id = std::max(ctx.next_quad_id, quad.id + 1);
+        info.scale = glm::vec2(quad.scale[0], quad.scale[1]);
+        info.blob_offset = quad.blob_offset;
+        info.blob_size = quad.blob_size;
+        if (quad.flags & BOARD_FILE_MIRROR_H) ctx.quads.flags[slot] |= QUAD_MIRROR_H;
+        if (quad.flags & BOARD_FILE_MIRROR_V) ctx.quads.flags[slot] |= QUAD_MIRROR_V;
+        if (quad.width > 0 && quad.height > 0) {
+            quad_set_texture_size(slot, glm::vec2(quad.width, quad.height));
+        } else {
+            ctx.quads.half_extents[slot] = info.scale;
+        }
+        if (quad.flags & BOARD_FILE_HIDDEN) quad_hide(slot);
+        quad_request_probe(slot);
+    }
+    if (journal) autosave_replay(*journal);
+    ctx.board_modified = journal != nullptr;
+
+    // Without the undo steps that could bring them back, deleted quads are gone for good.
+    for (uint32_t slot = 0; slot < slot_map_capacity(ctx.quad_slots); slot++) {
+        if (ctx.quad_slots.alive[slot] && (ctx.quads.flags[slot] & QUAD_HIDDEN)) {
+            quad_remove(slot_map_handle(ctx.quad_slots, slot));
+        }
+    }
+    autosave_take_snapshot();
+    return true;
+}
+
+// Restores the session a previous run left in the autosave of ctx.board_path, if there is one.
+// A board written after the journal's last edit, e.g. replaced since, is opened instead.
+bool autosave_recover() {
+    uint64_t revision = 0;
+    std::vector<AutosaveRecord> records;
+    if (!autosave_read_journal(ctx.autosave.journal_path.c_str(), revision, records)) {
+        return false;
+    }
+    uint64_t size;
+    int64_t board_mtime, journal_mtime;
+    if (file_stat(ctx.board_path.c_str(), size, board_mtime) &&
+        file_stat(ctx.autosave.journal_path.c_str(), size, journal_mtime) &&
+        board_mtime > journal_mtime) {
+        printf("[info] %s is newer than its autosave, the autosave is ignored\n",
+               ctx.board_path.c_str());
+        return false;
+    }
+    // Whatever happens next, new snapshots must not be mistaken for the one this journal follows.
+    ctx.autosave.revision = revision;
+    BoardFile snapshot;
+    if (!board_file_open(snapshot, ctx.autosave.snapshot_path.c_str())) return false;
+    uint64_t snapshot_revision = snapshot.header->revision;
+    board_file_close(snapshot);
+    // A crash between writing a snapshot and starting its journal leaves the previous journal
+    // behind, whose edits are all in the snapshot already.
+    if (revision != snapshot_revision) records.clear();
+    ctx.autosave.revision = std::max(revision, snapshot_revision);
+
+    if (!board_load(ctx.autosave.snapshot_path.c_str(), &records)) return false;
+    printf("[info] restored %s from its autosave, %zu edits replayed\n", ctx.board_path.c_str(),
+           records.size());
+    return true;
+}
+
+void request_redraw() {
+    ctx.redraw_frames = REDRAW_SETTLE_FRAMES;
+}
+
+// Everything that needs another frame: recent input or edits, atlas pages still being repacked,
+// detail still streaming in, decoded images to upload, texture memory of deleted quads still to
+// reclaim, and readbacks that only complete after further bgfx::frame calls.
+bool redraw_pending() {
+    return ctx.redraw_frames > 0 || ctx.readback_next_frame || ctx.save_next_available_frame ||
+           !ctx.texture_pages.pages_to_repack.empty() || ctx.residency.pending ||
+           ctx.tiled_images.pending || !ctx.texture_pages.retired_entries.empty() ||
+           !ctx.tiled_images.removed.empty() || image_loader_pending(ctx.image_loader);
+}
+
+// World-space rectangle seen by the camera, found by unprojecting the NDC corners.
+void camera_world_bounds(const glm::mat4& inverse_view_proj, glm::vec2& min, glm::vec2& max) {
+    glm::vec4 bottom_left = inverse_view_proj * glm::vec4(-1.0f, -1.0f, 0.0f, 1.0f);
+    glm::vec4 top_right = inverse_view_proj * glm::vec4(1.0f, 1.0f, 0.0f, 1.0f);
+    glm::vec2 a = glm::vec2(bottom_left.x, bottom_left.y) / bottom_left.w;
+    glm::vec2 b = glm::vec2(top_right.x, top_right.y) / top_right.w;
+    min = glm::min(a, b);
+    max = glm::max(a, b);
+}
+
+glm::vec2 world_to_screen(const glm::mat4& view_proj, glm::vec2 world) {
+    glm::vec4 clip_space = view_proj * glm::vec4(world.x, world.y, 0.0f, 1.0f);
+    glm::vec2 ndc_space = glm::vec2(clip_space.x / clip_space.w, clip_space.y / clip_space.w);
+    glm::vec2 screen_space = 0.5f * (ndc_space + glm::vec2(1.0f, 1.0f));
+    screen_space *= glm::vec2(ctx.window_width, ctx.window_height);
+    screen_space.y = ctx.window_height - screen_space.y;
+    return screen_space;
+}
+
+glm::vec2 screen_to_world(const glm::mat4& inverse_view_proj, glm::vec2 screen) {
+    glm::vec2 ndc_space = glm::vec2(screen.x / ctx.window_width * 2.0f - 1.0f,
+                                    1.0f - screen.y / ctx.window_height * 2.0f);
+    glm::vec4 world = inverse_view_proj * glm::vec4(ndc_space.x, ndc_space.y, 0.0f, 1.0f);
+    return glm::vec2(world.x / world.w, world.y / world.w);
+}
+
+void camera_update() {
+    if (ctx.cached_camera_version == ctx.camera_version) return;
+    ctx.cached_camera_version = ctx.camera_version;
+
+    ctx.proj = glm::ortho(-1.0f * ctx.aspect_ratio * ctx.camera_zoom,
+                          1.0f * ctx.aspect_ratio * ctx.camera_zoom, -1.0f * ctx.camera_zoom,
+                          1.0f * ctx.camera_zoom, 0.0f, 100.0f);
+    ctx.view_proj = ctx.proj * ctx.view;
+    ctx.inverse_view_proj = glm::inverse(ctx.view_proj);
+    camera_world_bounds(ctx.inverse_view_proj, ctx.camera_min, ctx.camera_max);
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    request_redraw();
+    if (action != GLFW_PRESS || ImGui::GetIO().WantCaptureKeyboard) {
+        return;
+    }
+
+    bool command = mods & (GLFW_MOD_CONTROL | GLFW_MOD_SUPER);
+    if (key == GLFW_KEY_A && command) {
+        selection_select_all();
+    } else if (key == GLFW_KEY_Z && command) {
+        if (mods & GLFW_MOD_SHIFT) {
+            redo();
+        } else {
+            undo();
+        }
+    } else if (key == GLFW_KEY_Y && command) {
+        redo();
+    } else if (key == GLFW_KEY_DELETE || key == GLFW_KEY_BACKSPACE) {
+        selection_delete();
+    }
+}
+
+void char_callback(GLFWwindow* window, unsigned int codepoint) {
+    request_redraw();
+}
+
+void window_focus_callback(GLFWwindow* window, int focused) {
+    request_redraw();
+}
+
+void cursor_enter_callback(GLFWwindow* window, int entered) {
+    request_redraw();
+}
+
+void window_refresh_callback(GLFWwindow* window) {
+    request_redraw();
+}
+
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
+    request_redraw();
     ctx.camera_zoom -= (float)yoffset * 0.1f;
     ctx.camera_zoom = glm::clamp(ctx.camera_zoom, 0.001f, 1000.0f);
+    ctx.camera_version++;
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    request_redraw();
     ImGuiIO& io = ImGui::GetIO();
     if (io.WantCaptureMouse) {
         return;
@@ -94,124 +1177,353 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
             double xpos, ypos;
             glfwGetCursorPos(ctx.window, &xpos, &ypos);
 
+            // Shift adds to the selection, ctrl (cmd on macOS) toggles single quads in and out.
+            bool add = mods & GLFW_MOD_SHIFT;
+            bool toggle = mods & (GLFW_MOD_CONTROL | GLFW_MOD_SUPER);
             if (ctx.erase_mode) {
                 ctx.erasing = true;
-            } else {
-                if (ctx.hovered_quad > -1) {
-                    ctx.selected_quad = ctx.hovered_quad;
-                    ctx.dragged_quad = ctx.hovered_quad;
-                    ctx.drag_start_mouse_pos = glm::vec2(xpos, ypos);
-                    ctx.drag_start_quad_pos = ctx.quads[ctx.hovered_quad].position;
-                } else {
-                    ctx.selected_quad = -1;
+            } else if (quad_alive(ctx.hovered_quad)) {
+                uint32_t slot = ctx.hovered_quad.index;
+                bool selected = ctx.quads.flags[slot] & QUAD_SELECTED;
+                if (toggle && selected) {
+                    selection_remove(slot);
+                } else if (!selected) {
+                    if (!add && !toggle) selection_clear();
+                    selection_add(slot);
+                }
+                if (ctx.quads.flags[slot] & QUAD_SELECTED) {
+                    selection_begin_drag(glm::vec2(xpos, ypos));
                 }
+            } else {
+                if (!add && !toggle) selection_clear();
+                ctx.marquee = true;
+                ctx.marquee_start = screen_to_world(ctx.inverse_view_proj, glm::vec2(xpos, ypos));
+                ctx.marquee_end = ctx.marquee_start;
             }
         } else if (action == GLFW_RELEASE) {
-            ctx.dragged_quad = -1;
+            if (ctx.marquee) {
+                selection_select_rect(glm::min(ctx.marquee_start, ctx.marquee_end),
+                                      glm::max(ctx.marquee_start, ctx.marquee_end));
+                ctx.marquee = false;
+            }
+            if (ctx.dragging) {
+                selection_end_drag();
+            }
             ctx.erasing = false;
         }
     }
 }
 
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
-    if (ctx.dragged_quad > -1 && !ctx.erase_mode) {
+    request_redraw();
+    if (ctx.dragging && !ctx.erase_mode) {
         glm::vec2 current_mouse_pos = glm::vec2(xpos, ypos);
         glm::vec2 delta = current_mouse_pos - ctx.drag_start_mouse_pos;
         delta /= 100.0f;
-        ctx.quads[ctx.dragged_quad].position =
-            ctx.drag_start_quad_pos + glm::vec3(delta.x, -delta.y, 0);
+        ctx.drag_offset = glm::vec2(delta.x, -delta.y);
+        ctx.drag_moved = true;
+    }
+    if (ctx.marquee) {
+        ctx.marquee_end = screen_to_world(ctx.inverse_view_proj, glm::vec2(xpos, ypos));
     }
 }
 
-std::function<void()> main_loop = []() {
-    glfwPollEvents();
+// Binds the page holding a quad's image along with what the fragment shader needs to pick and
+// clamp its mip level.
+void set_quad_texture(int texture_entry) {
+    glm::vec4 sampling = texture_pages_sampling(ctx.texture_pages, texture_entry);
+    bgfx::setTexture(0, ctx.uniform_handle, texture_pages_texture(ctx.texture_pages, texture_entry),
+                     TEXTURE_PAGE_SAMPLER_FLAGS);
+    bgfx::setUniform(ctx.texture_page_uniform_handle, glm::value_ptr(sampling));
+}
 
-    ImGuiIO& io = ImGui::GetIO();
-    ImVec2 mouse_pos = ImGui::GetMousePos();
-    glm::vec2 mouse_pos_glm(mouse_pos.x, mouse_pos.y);
+// Uploads ctx.instances in one instance buffer and submits one draw per run of quads that share a
+// texture, so the number of draw calls follows the number of texture changes, not quads.
+void submit_quad_instances() {
+    uint32_t count = uint32_t(ctx.instances.size());
+    if (count == 0) return;
+
+    const uint16_t stride = sizeof(QuadInstance);
+    if (bgfx::getAvailInstanceDataBuffer(count, stride) < count) {
+        printf("[error] not enough space for %u quad instances\n", count);
+        return;
+    }
+
+    bgfx::InstanceDataBuffer instance_buffer;
+    bgfx::allocInstanceDataBuffer(&instance_buffer, count, stride);
+    memcpy(instance_buffer.data, ctx.instances.data(), count * stride);
 
-    glm::mat4 proj = glm::ortho(-1.0f * ctx.aspect_ratio * ctx.camera_zoom,
-                                1.0f * ctx.aspect_ratio * ctx.camera_zoom, -1.0f * ctx.camera_zoom,
-                                1.0f * ctx.camera_zoom, 0.0f, 100.0f);
+    uint32_t run_start = 0;
+    uint16_t run_texture = texture_pages_texture(ctx.texture_pages, ctx.instance_entries[0]).idx;
+    for (uint32_t i = 1; i <= count; i++) {
+        if (i < count &&
+            texture_pages_texture(ctx.texture_pages, ctx.instance_entries[i]).idx == run_texture) {
+            continue;
+        }
+        bgfx::setState(QUAD_RENDER_STATE);
+        bgfx::setVertexBuffer(VIEW_RENDER, ctx.vertex_buffer_handle);
+        bgfx::setIndexBuffer(ctx.index_buffer_handle);
+        bgfx::setInstanceDataBuffer(&instance_buffer, run_start, i - run_start);
+        set_quad_texture(ctx.instance_entries[run_start]);
+        bgfx::submit(VIEW_RENDER, ctx.instanced_program);
+        run_start = i;
+        if (i < count) {
+            run_texture = texture_pages_texture(ctx.texture_pages, ctx.instance_entries[i]).idx;
+        }
+    }
+}
 
-    int i = 0;
-    ctx.hovered_quad = -1;
-    float hovered_z = 1;
+void create_capture_targets() {
+    ctx.render_texture_handle =
+        bgfx::createTexture2D(ctx.window_width, ctx.window_height, false, 1,
+                              bgfx::TextureFormat::RGBA8, BGFX_TEXTURE_RT, NULL);
 
-    std::sort(ctx.quads.begin(), ctx.quads.end(),
-              [](const Quad& a, const Quad& b) { return a.z_index < b.z_index; });
+    bgfx::TextureHandle framebuffer_textures[] = {ctx.render_texture_handle};
 
-    for (auto& quad : ctx.quads) {
-        quad.position.z = -quad.z_index;
+    ctx.framebuffer_handle =
+        bgfx::createFrameBuffer(BX_COUNTOF(framebuffer_textures), framebuffer_textures, true);
+    ctx.readback_texture_handle = bgfx::createTexture2D(
+        ctx.window_width, ctx.window_height, false, 1, bgfx::TextureFormat::RGBA8,
+        BGFX_TEXTURE_READ_BACK | BGFX_TEXTURE_BLIT_DST, NULL);
+    ctx.pixels = std::vector<uint8_t>(ctx.window_width * ctx.window_height * 4);
+}
 
-        if (quad.deleted) continue;
-        glm::mat4 model = glm::mat4(1.0);
-        model = glm::translate(model, quad.position);
-        model = glm::scale(
-            model,
-            glm::vec3((quad.mirror_h ? -1.0 : 1.0) *
-                          (float(quad.texture_size.x) / float(quad.texture_size.y)) * quad.scale.x,
-                      (quad.mirror_v ? -1.0 : 1.0) * quad.scale.y, 1.0));
-        glm::vec4 corners[4] = {
-            glm::vec4(-1.0f, -1.0f, 0.0f, 1.0f), glm::vec4(1.0f, -1.0f, 0.0f, 1.0f),
-            glm::vec4(-1.0f, 1.0f, 0.0f, 1.0f), glm::vec4(1.0f, 1.0f, 0.0f, 1.0f)};
+void release_capture_targets() {
+    // The framebuffer owns the render texture and destroys it along with itself.
+    bgfx::destroy(ctx.framebuffer_handle);
+    bgfx::destroy(ctx.readback_texture_handle);
+    ctx.framebuffer_handle = BGFX_INVALID_HANDLE;
+    ctx.render_texture_handle = BGFX_INVALID_HANDLE;
+    ctx.readback_texture_handle = BGFX_INVALID_HANDLE;
+    ctx.pixels = std::vector<uint8_t>();
+}
 
-        glm::mat4 mvp = proj * ctx.view * model;
+void push_quad_part(uint32_t slot, const glm::vec4& local_rect, int texture_entry,
+                    const glm::vec4& uv_rect) {
+    glm::vec2 position = ctx.quads.positions[slot];
+    glm::vec2 model_scale = quad_model_scale(slot);
+    ctx.instances.push_back(
+        QuadInstance{.position = glm::vec4(position.x, position.y, 0.0f, 0.0f),
+                     .scale = glm::vec4(model_scale.x, model_scale.y, 1.0f, 0.0f),
+                     .uv_rect = uv_rect,
+                     .local_rect = local_rect});
+    ctx.instance_entries.push_back(texture_entry);
+    ctx.instance_slots.push_back(slot);
+}
 
-        for (int i = 0; i < 4; ++i) {
-            glm::vec4 clip_space = mvp * corners[i];
-            glm::vec2 ndc_space =
-                glm::vec2(clip_space.x / clip_space.w, clip_space.y / clip_space.w);
-            glm::vec2 screen_space = 0.5f * (ndc_space + glm::vec2(1.0f, 1.0f));
-            screen_space *= glm::vec2(ctx.window_width, ctx.window_height);
-            screen_space.y = ctx.window_height - screen_space.y;
-            if (i == 0) {
-                quad.min_corner = glm::vec2(screen_space.x, screen_space.y);
-                quad.max_corner = glm::vec2(screen_space.x, screen_space.y);
+// Builds the palette placeholders are drawn from, every RGBA colour at 4 bits per channel, and the
+// checkerboard of broken quads.
+void placeholders_create() {
+    ctx.placeholder_palette.resize(PLACEHOLDER_PALETTE_SIZE * PLACEHOLDER_PALETTE_SIZE * 4);
+    for (uint32_t i = 0; i < PLACEHOLDER_PALETTE_SIZE * PLACEHOLDER_PALETTE_SIZE; i++) {
+        for (uint32_t channel = 0; channel < 4; channel++) {
+            ctx.placeholder_palette[i * 4 + channel] = uint8_t(((i >> (channel * 4)) & 15) * 17);
+        }
+    }
+    ctx.placeholder_entry = texture_pages_add(ctx.texture_pages, ctx.placeholder_palette.data(),
+                                              PLACEHOLDER_PALETTE_SIZE, PLACEHOLDER_PALETTE_SIZE);
+
+    ctx.broken_pixels.resize(PLACEHOLDER_BROKEN_SIZE * PLACEHOLDER_BROKEN_SIZE * 4);
+    for (uint32_t y = 0; y < PLACEHOLDER_BROKEN_SIZE; y++) {
+        for (uint32_t x = 0; x < PLACEHOLDER_BROKEN_SIZE; x++) {
+            uint32_t color = (x + y) % 2 ? 0xff000000 : 0xffff00ff;
+            memcpy(&ctx.broken_pixels[(y * PLACEHOLDER_BROKEN_SIZE + x) * 4], &color, 4);
+        }
+    }
+    ctx.broken_entry = texture_pages_add(ctx.texture_pages, ctx.broken_pixels.data(),
+                                         PLACEHOLDER_BROKEN_SIZE, PLACEHOLDER_BROKEN_SIZE);
+}
+
+// A zero sized uv rect on the palette texel closest to color, so the whole quad samples just it.
+glm::vec4 placeholder_uv_rect(uint32_t color) {
+    if (color == 0) color = PLACEHOLDER_DEFAULT_COLOR;
+    uint32_t index = 0;
+    for (uint32_t channel = 0; channel < 4; channel++) {
+        index |= ((color >> (channel * 8 + 4)) & 15) << (channel * 4);
+    }
+    glm::vec2 texel = glm::vec2(index % PLACEHOLDER_PALETTE_SIZE, index / PLACEHOLDER_PALETTE_SIZE);
+    glm::vec2 fraction = (texel + 0.5f) / float(PLACEHOLDER_PALETTE_SIZE);
+    glm::vec4 rect = texture_pages_uv_rect(ctx.texture_pages, ctx.placeholder_entry);
+    glm::vec2 min = glm::vec2(rect.x, rect.y);
+    glm::vec2 uv = min + (glm::vec2(rect.z, rect.w) - min) * fraction;
+    return glm::vec4(uv.x, uv.y, uv.x, uv.y);
+}
+
+// Culls the board and lists the parts to draw, bottom to top. Residency and tile requests are only
+// made here, so detail is only asked for again once the camera, the board or the textures change.
+void build_quad_parts() {
+    ctx.instances.clear();
+    ctx.instance_entries.clear();
+    ctx.instance_slots.clear();
+
+    // Culling is a query on the index, only the quads it returns are put back in stacking order.
+    ctx.visible_quads.clear();
+    spatial_index_query(ctx.spatial_index, ctx.camera_min, ctx.camera_max, ctx.visible_quads);
+    std::sort(ctx.visible_quads.begin(), ctx.visible_quads.end(),
+              [](uint32_t a, uint32_t b) { return z_order_is_above(ctx.z_order, b, a); });
+
+    // The screen rectangles of all visible quads are projected in one batch.
+    bounds_soa_clear(ctx.visible_world_bounds);
+    for (uint32_t slot : ctx.visible_quads) {
+        const SpatialItem& bounds = ctx.spatial_index.items[slot];
+        bounds_soa_push(ctx.visible_world_bounds, bounds.min, bounds.max);
+    }
+    screen_bounds_project(ctx.visible_world_bounds,
+                          screen_transform(ctx.view_proj, ctx.window_width, ctx.window_height),
+                          ctx.visible_screen_bounds);
+
+    for (uint32_t i = 0; i < ctx.visible_quads.size(); i++) {
+        uint32_t slot = ctx.visible_quads[i];
+        int image = ctx.quads.images[slot];
+        if (image < 0) {
+            if (ctx.quads.flags[slot] & QUAD_UNLOADED) quad_request_image(slot);
+            if (ctx.quads.flags[slot] & QUAD_BROKEN) {
+                push_quad_part(slot, glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f), ctx.broken_entry,
+                               texture_pages_uv_rect(ctx.texture_pages, ctx.broken_entry));
             } else {
-                quad.min_corner =
-                    glm::min(quad.min_corner, glm::vec2(screen_space.x, screen_space.y));
-                quad.max_corner =
-                    glm::max(quad.max_corner, glm::vec2(screen_space.x, screen_space.y));
+                push_quad_part(slot, glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f), ctx.placeholder_entry,
+                               placeholder_uv_rect(ctx.quads.info[slot].color));
             }
+            continue;
         }
+        const BoundsSoA& screen = ctx.visible_screen_bounds;
+        float screen_width = screen.max_x[i] - screen.min_x[i];
+        float texels_per_pixel = ctx.quads.texture_widths[slot] / screen_width;
+
+        if (ctx.quads.flags[slot] & QUAD_TILED) {
+            // Only the tiles under the camera are drawn, found from the view in quad-local space.
+            glm::vec2 position = ctx.quads.positions[slot];
+            glm::vec2 model_scale = quad_model_scale(slot);
+            glm::vec2 a = (ctx.camera_min - position) / model_scale;
+            glm::vec2 b = (ctx.camera_max - position) / model_scale;
+            ctx.tile_draws.clear();
+            tiled_images_collect(ctx.tiled_images, ctx.texture_pages, image, glm::min(a, b),
+                                 glm::max(a, b), texels_per_pixel, ctx.tile_draws);
+            for (const TileDraw& tile : ctx.tile_draws) {
+                push_quad_part(slot, tile.local_rect, tile.texture_entry, tile.uv_rect);
+            }
+        } else {
+            residency_request(ctx.residency, image, texels_per_pixel);
+            // Zoomed in past the texels of a reduced image.
+            uint16_t flags = ctx.quads.flags[slot];
+            if ((flags & QUAD_REDUCED) && !(flags & QUAD_LOADING) && texels_per_pixel < 1.0f) {
+                quad_request_image(slot, true);
+            }
+            int texture_entry = ctx.residency.images[image].texture_entry;
+            push_quad_part(slot, glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f), texture_entry,
+                           texture_pages_uv_rect(ctx.texture_pages, texture_entry));
+        }
+    }
 
-        bgfx::setViewFrameBuffer(VIEW_RENDER, ctx.framebuffer_handle);
-        bgfx::setViewClear(VIEW_RENDER, BGFX_CLEAR_COLOR, 0x303030ff, 1.0f, 0);
-        bgfx::setState(
-            BGFX_STATE_WRITE_RGB |
-            BGFX_STATE_BLEND_FUNC(BGFX_STATE_BLEND_SRC_ALPHA, BGFX_STATE_BLEND_INV_SRC_ALPHA) |
-            BGFX_STATE_BLEND_ALPHA);
-        bgfx::setViewRect(VIEW_RENDER, 0, 0, uint16_t(ctx.window_width),
-                          uint16_t(ctx.window_height));
-        bgfx::setViewTransform(VIEW_RENDER, glm::value_ptr(ctx.view), glm::value_ptr(proj));
+    ctx.parts_camera_version = ctx.camera_version;
+    ctx.parts_board_version = ctx.board_version;
+    ctx.parts_texture_version = ctx.texture_pages.version;
+}
+
+// Without instancing every part gets its own submit, transformed by the quad's cached model.
+void submit_quad_parts() {
+    for (size_t i = 0; i < ctx.instances.size(); i++) {
+        const QuadInstance& part = ctx.instances[i];
+        glm::mat4 model = ctx.quads.models[ctx.instance_slots[i]];
+        // Only tiles cover less than the whole quad.
+        if (part.local_rect != glm::vec4(-1.0f, -1.0f, 1.0f, 1.0f)) {
+            const glm::vec4& r = part.local_rect;
+            model = glm::translate(model, glm::vec3((r.x + r.z) * 0.5f, (r.y + r.w) * 0.5f, 0.0f));
+            model = glm::scale(model, glm::vec3((r.z - r.x) * 0.5f, (r.w - r.y) * 0.5f, 1.0f));
+        }
+
+        bgfx::setState(QUAD_RENDER_STATE);
         bgfx::setVertexBuffer(VIEW_RENDER, ctx.vertex_buffer_handle);
         bgfx::setIndexBuffer(ctx.index_buffer_handle);
-        bgfx::setTexture(0, ctx.uniform_handle, quad.texture_handle);
+        set_quad_texture(ctx.instance_entries[i]);
+        bgfx::setUniform(ctx.uv_rect_uniform_handle, glm::value_ptr(part.uv_rect));
         bgfx::setTransform(glm::value_ptr(model));
         bgfx::submit(VIEW_RENDER, ctx.program);
+    }
+}
 
-        if ((mouse_pos_glm.x >= quad.min_corner.x && mouse_pos_glm.x <= quad.max_corner.x &&
-             mouse_pos_glm.y >= quad.min_corner.y && mouse_pos_glm.y <= quad.max_corner.y)) {
-            if (quad.position.z < hovered_z) {
-                ctx.hovered_quad = i;
-                hovered_z = quad.position.z;
-            }
+std::function<void()> main_loop = []() {
+    glfwPollEvents();
+#ifdef EMSCRIPTEN
+    autosave_update(ctx.autosave, glfwGetTime());
+#endif
+    if (!redraw_pending()) {
+        return;
+    }
+
+    ImGuiIO& io = ImGui::GetIO();
+    ImVec2 mouse_pos = ImGui::GetMousePos();
+
+    // Texture changes go first so that no draw of this frame samples a region that is rewritten.
+    residency_update(ctx.residency, ctx.texture_pages);
+    tiled_images_update(ctx.tiled_images, ctx.texture_pages);
+    texture_pages_update(ctx.texture_pages);
+    // Only what was edited or moved since the last frame is recomputed.
+    undo_release_dropped();
+    if (ctx.autosave.records_since_snapshot >= AUTOSAVE_COMPACT_RECORDS) {
+        autosave_take_snapshot();
+    }
+    quads_receive_images();
+    selection_apply_drag();
+    quads_update_dirty();
+    camera_update();
+    glm::vec2 mouse_pos_glm(mouse_pos.x, mouse_pos.y);
+
+    // The mouse is brought into world space once and looked up in the index, the topmost hit is
+    // the hovered quad.
+    glm::vec2 mouse_world = screen_to_world(ctx.inverse_view_proj, mouse_pos_glm);
+    ctx.hovered_quad = Handle{};
+    ctx.picked_quads.clear();
+    spatial_index_query(ctx.spatial_index, mouse_world, mouse_world, ctx.picked_quads);
+    for (uint32_t slot : ctx.picked_quads) {
+        if (ctx.hovered_quad.index == UINT32_MAX ||
+            z_order_is_above(ctx.z_order, slot, ctx.hovered_quad.index)) {
+            ctx.hovered_quad = slot_map_handle(ctx.quad_slots, slot);
         }
-        i++;
     }
 
-    bgfx::setViewFrameBuffer(VIEW_COPY_TO_FRAMEBUFFER, BGFX_INVALID_HANDLE);
-    bgfx::setViewClear(VIEW_COPY_TO_FRAMEBUFFER, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH, 0x000000ff,
-                       1.0f, 0);
-    bgfx::setViewRect(VIEW_COPY_TO_FRAMEBUFFER, 0, 0, uint16_t(ctx.window_width),
-                      uint16_t(ctx.window_height));
-    bgfx::setVertexBuffer(VIEW_COPY_TO_FRAMEBUFFER, ctx.vertex_buffer_handle);
-    bgfx::setTexture(0, ctx.uniform_handle, ctx.render_texture_handle);
-    bgfx::setIndexBuffer(ctx.index_buffer_handle);
-    bgfx::submit(VIEW_COPY_TO_FRAMEBUFFER, ctx.program);
+    // A capture frame renders offscreen so the result can be read back, then copies it to the
+    // screen. Every other frame skips both and draws to the backbuffer.
+    bool capture = ctx.readback_next_frame;
+    if (capture && !bgfx::isValid(ctx.framebuffer_handle)) {
+        create_capture_targets();
+    }
+    bgfx::setViewFrameBuffer(VIEW_RENDER, capture ? ctx.framebuffer_handle
+                                                  : bgfx::FrameBufferHandle(BGFX_INVALID_HANDLE));
+    bgfx::setViewClear(VIEW_RENDER, BGFX_CLEAR_COLOR, 0x303030ff, 1.0f, 0);
+    bgfx::setViewRect(VIEW_RENDER, 0, 0, uint16_t(ctx.window_width), uint16_t(ctx.window_height));
+    bgfx::setViewTransform(VIEW_RENDER, glm::value_ptr(ctx.view), glm::value_ptr(ctx.proj));
+    bgfx::touch(VIEW_RENDER);
+
+    // Streaming images are still asking for detail, their requests have to be made every frame.
+    if (ctx.parts_camera_version != ctx.camera_version ||
+        ctx.parts_board_version != ctx.board_version ||
+        ctx.parts_texture_version != ctx.texture_pages.version || ctx.residency.pending ||
+        ctx.tiled_images.pending) {
+        build_quad_parts();
+    }
+    if (ctx.instanced_rendering && (bgfx::getCaps()->supported & BGFX_CAPS_INSTANCING) != 0) {
+        submit_quad_instances();
+    } else {
+        submit_quad_parts();
+    }
+
+    if (capture) {
+        bgfx::setViewFrameBuffer(VIEW_COPY_TO_FRAMEBUFFER, BGFX_INVALID_HANDLE);
+        bgfx::setViewClear(VIEW_COPY_TO_FRAMEBUFFER, BGFX_CLEAR_COLOR | BGFX_CLEAR_DEPTH,
+                           0x000000ff, 1.0f, 0);
+        bgfx::setViewRect(VIEW_COPY_TO_FRAMEBUFFER, 0, 0, uint16_t(ctx.window_width),
+                          uint16_t(ctx.window_height));
+        glm::vec4 full_uv_rect(0.0f, 0.0f, 1.0f, 1.0f);
+        glm::vec4 render_texture_sampling(ctx.window_width, ctx.window_height, 0.0f, 0.0f);
+        bgfx::setVertexBuffer(VIEW_COPY_TO_FRAMEBUFFER, ctx.vertex_buffer_handle);
+        bgfx::setTexture(0, ctx.uniform_handle, ctx.render_texture_handle);
+        bgfx::setUniform(ctx.uv_rect_uniform_handle, glm::value_ptr(full_uv_rect));
+        bgfx::setUniform(ctx.texture_page_uniform_handle,
+                         glm::value_ptr(render_texture_sampling));
+        bgfx::setIndexBuffer(ctx.index_buffer_handle);
+        bgfx::submit(VIEW_COPY_TO_FRAMEBUFFER, ctx.program);
 
-    if (ctx.readback_next_frame) {
         bgfx::blit(VIEW_BLIT, ctx.readback_texture_handle, 0, 0,
                    bgfx::getTexture(ctx.framebuffer_handle));
         ctx.frame_when_readback_available =
@@ -230,23 +1542,70 @@ std::function<void()> main_loop = []() {
 
     ImGui::Text("Welcome to boardthing");
 
-    int x = 0;
-    for (auto& quad : ctx.quads) {
-        ImGui::Text((std::to_string(x) + " quad, z_index: " + std::to_string(quad.z_index) +
-                     " , pos: " + glm::to_string(quad.position))
-                        .c_str());
-        x++;
+    ImGui::Text("%u quads, %zu selected", ctx.quad_slots.count - ctx.hidden_quads,
+                ctx.selected_quads.size());
+    ImGui::SameLine();
+    if (ImGui::Button("Undo")) {
+        undo();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Redo")) {
+        redo();
+    }
+    ImGui::SameLine();
+    ImGui::Text("history: %zu KB, %zu MB held", undo_journal_bytes(ctx.undo) >> 10,
+                ctx.undo_payload_bytes >> 20);
+    // Only the rows in view are formatted, the list stays cheap on boards with thousands of quads.
+    ImGuiListClipper clipper;
+    clipper.Begin(int(ctx.z_order.count - ctx.hidden_quads));
+    while (clipper.Step()) {
+        uint32_t slot = z_order_shown_from(ctx.z_order.bottom);
+        for (int x = 0; x < clipper.DisplayStart; x++) {
+            slot = z_order_shown_from(ctx.z_order.nodes[slot].above);
+        }
+        for (int x = clipper.DisplayStart; x < clipper.DisplayEnd; x++) {
+            ImGui::Text((std::to_string(x) + " quad, slot: " + std::to_string(slot) +
+                         " , pos: " + glm::to_string(ctx.quads.positions[slot]))
+                            .c_str());
+            slot = z_order_shown_from(ctx.z_order.nodes[slot].above);
+        }
+    }
+
+    ImGui::Checkbox("Instanced rendering", &ctx.instanced_rendering);
+    ImGui::SameLine();
+    ImGui::Text("draw calls: %u", bgfx::getStats()->numDraw);
+    ImGui::Text("textures: %zu / %zu MB, tiles: %zu / %zu MB", ctx.residency.resident_bytes >> 20,
+                ctx.residency.budget_bytes >> 20, ctx.tiled_images.resident_bytes >> 20,
+                ctx.tiled_images.budget_bytes >> 20);
+    // Applies to images loaded from now on, the ones already resident keep their format.
+    int preset = int(ctx.texture_compression.preset);
+    if (ImGui::Combo("Texture compression", &preset, texture_compression_preset_names,
+                     TEXTURE_COMPRESSION_PRESET_COUNT)) {
+        ctx.texture_compression = texture_compression_choose(TextureCompressionPreset(preset));
     }
 
     if (ImGui::Button("Save")) {
         ctx.readback_next_frame = true;
     }
+    ImGui::SameLine();
+    if (ImGui::Button("Save board")) {
+        if (board_save(ctx.board_path.c_str(), ctx.embed_images)) ctx.board_modified = false;
+        image_index_save(ctx.image_index, (ctx.board_path + ".index").c_str());
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load board")) {
+        board_load(ctx.board_path.c_str());
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Embed images", &ctx.embed_images);
+    ImGui::SameLine();
+    ImGui::Text("%s", ctx.board_path.c_str());
     if (ctx.show_saved_notification) {
         ImGui::Text("Saved canvas to output.png");
     }
     ImGui::End();
 
-    if (ctx.hovered_quad > -1 && !ctx.erase_mode) {
+    if (quad_alive(ctx.hovered_quad) && !ctx.erase_mode) {
         ImGui::SetMouseCursor(ImGuiMouseCursor_Hand);
     } else {
         ImGui::SetMouseCursor(ImGuiMouseCursor_Arrow);
@@ -257,21 +1616,38 @@ std::function<void()> main_loop = []() {
         draw_list->AddCircle(mouse_pos, 20, IM_COL32(255, 0, 0, 255), 30, 3.0f);
     }
 
-    if (ctx.selected_quad > -1) {
-        draw_list->AddRect(ImVec2(ctx.quads[ctx.selected_quad].min_corner.x - 5,
-                                  ctx.quads[ctx.selected_quad].min_corner.y - 5),
-                           ImVec2(ctx.quads[ctx.selected_quad].max_corner.x + 5,
-                                  ctx.quads[ctx.selected_quad].max_corner.y + 5),
+    if (ctx.marquee) {
+        glm::vec2 a = world_to_screen(ctx.view_proj, ctx.marquee_start);
+        glm::vec2 b = world_to_screen(ctx.view_proj, ctx.marquee_end);
+        draw_list->AddRectFilled(ImVec2(glm::min(a, b).x, glm::min(a, b).y),
+                                 ImVec2(glm::max(a, b).x, glm::max(a, b).y),
+                                 IM_COL32(0, 120, 255, 40));
+        draw_list->AddRect(ImVec2(glm::min(a, b).x, glm::min(a, b).y),
+                           ImVec2(glm::max(a, b).x, glm::max(a, b).y), IM_COL32(0, 120, 255, 255),
+                           0.0f, 0, 1.0f);
+    }
+
+    // The selection is outlined as a whole, one rectangle however many quads it holds.
+    bool selected = !ctx.selected_quads.empty();
+    if (selected) {
+        selection_update_bounds();
+    }
+    if (selected && ctx.selection_max.x >= ctx.camera_min.x &&
+        ctx.selection_min.x <= ctx.camera_max.x && ctx.selection_max.y >= ctx.camera_min.y &&
+        ctx.selection_min.y <= ctx.camera_max.y) {
+        glm::vec2 a = world_to_screen(ctx.view_proj, ctx.selection_min);
+        glm::vec2 b = world_to_screen(ctx.view_proj, ctx.selection_max);
+        glm::vec2 min_corner = glm::min(a, b);
+        glm::vec2 max_corner = glm::max(a, b);
+
+        draw_list->AddRect(ImVec2(min_corner.x - 5, min_corner.y - 5),
+                           ImVec2(max_corner.x + 5, max_corner.y + 5),
                            IM_COL32(0, 255, 0, 255), 0.0f, 0, 3.0f);
 
-        ImVec2 corners[4] = {ImVec2(ctx.quads[ctx.selected_quad].min_corner.x,
-                                    ctx.quads[ctx.selected_quad].min_corner.y),
-                             ImVec2(ctx.quads[ctx.selected_quad].max_corner.x,
-                                    ctx.quads[ctx.selected_quad].min_corner.y),
-                             ImVec2(ctx.quads[ctx.selected_quad].min_corner.x,
-                                    ctx.quads[ctx.selected_quad].max_corner.y),
-                             ImVec2(ctx.quads[ctx.selected_quad].max_corner.x,
-                                    ctx.quads[ctx.selected_quad].max_corner.y)};
+        ImVec2 corners[4] = {ImVec2(min_corner.x, min_corner.y),
+                             ImVec2(max_corner.x, min_corner.y),
+                             ImVec2(min_corner.x, max_corner.y),
+                             ImVec2(max_corner.x, max_corner.y)};
 
         for (int i = 0; i < 4; ++i) {
             draw_list->AddRectFilled(ImVec2(corners[i].x - 10, corners[i].y - 10),
@@ -279,8 +1655,7 @@ std::function<void()> main_loop = []() {
                                      IM_COL32(255, 0, 0, 255));
         }
 
-        ImGui::SetNextWindowPos(ImVec2(ctx.quads[ctx.selected_quad].min_corner.x,
-                                       ctx.quads[ctx.selected_quad].min_corner.y - 40),
+        ImGui::SetNextWindowPos(ImVec2(min_corner.x, min_corner.y - 40),
                                 ImGuiCond_Always);
         ImGui::SetNextWindowSize(ImVec2(0, 0));
         ImGui::Begin("##hidden", nullptr,
@@ -292,42 +1667,56 @@ std::function<void()> main_loop = []() {
         }
         ImGui::SameLine();
         if (ImGui::Button("Mirror V")) {
-            ctx.quads[ctx.selected_quad].mirror_v = !ctx.quads[ctx.selected_quad].mirror_v;
+            selection_mirror(QUAD_MIRROR_V);
+            request_redraw();
         }
         ImGui::SameLine();
         if (ImGui::Button("Mirror H")) {
-            ctx.quads[ctx.selected_quad].mirror_h = !ctx.quads[ctx.selected_quad].mirror_h;
+            selection_mirror(QUAD_MIRROR_H);
+            request_redraw();
         }
         ImGui::SameLine();
         if (ImGui::Button("↑")) {
-            if (ctx.selected_quad < ctx.quads.size() - 1) {
-                ctx.quads[ctx.selected_quad].z_index++;
-                ctx.quads[ctx.selected_quad + 1].z_index--;
-                ctx.selected_quad++;
-            }
+            selection_raise();
+            request_redraw();
         }
         ImGui::SameLine();
         if (ImGui::Button("↓")) {
-            if (ctx.selected_quad > 0) {
-                ctx.quads[ctx.selected_quad].z_index--;
-                ctx.quads[ctx.selected_quad - 1].z_index++;
-                ctx.selected_quad--;
-            }
+            selection_lower();
+            request_redraw();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Front")) {
+            selection_bring_to_front();
+            request_redraw();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Back")) {
+            selection_send_to_back();
+            request_redraw();
         }
         ImGui::SameLine();
         ImGui::Button("Rotate");
         ImGui::SameLine();
         if (ImGui::Button("Delete")) {
-            ctx.quads[ctx.selected_quad].deleted = true;
-            ctx.selected_quad = -1;
+            selection_delete();
+            request_redraw();
         }
         ImGui::End();
     }
+
+    // A held widget (dragged window, pressed button) keeps the board drawing until it is released.
+    if (ImGui::IsAnyItemActive()) {
+        request_redraw();
+    }
     ImGui::Render();
 
     ImGui_Implbgfx_RenderDrawLists(ImGui::GetDrawData());
 
     uint32_t frame_number = bgfx::frame();
+    if (ctx.redraw_frames > 0) {
+        ctx.redraw_frames--;
+    }
 
     if (ctx.save_next_available_frame && frame_number >= ctx.frame_when_readback_available) {
         stbi_flip_vertically_on_write(true);
@@ -335,6 +1724,9 @@ std::function<void()> main_loop = []() {
                        ctx.window_width * 4);
         ctx.save_next_available_frame = false;
         ctx.show_saved_notification = true;
+        if (!ctx.readback_next_frame) {
+            release_capture_targets();
+        }
     }
 };
 
@@ -342,7 +1734,7 @@ void emscripten_main_loop_wrapper() {
     main_loop();
 }
 
-int main() {
+int main(int argc, char** argv) {
     if (!glfwInit()) {
         printf("[error] failed to initialize GLFW\n");
         return -1;
@@ -361,6 +1753,11 @@ int main() {
     glfwSetCursorPosCallback(ctx.window, cursor_position_callback);
     glfwSetMouseButtonCallback(ctx.window, mouse_button_callback);
     glfwSetScrollCallback(ctx.window, scroll_callback);
+    glfwSetKeyCallback(ctx.window, key_callback);
+    glfwSetCharCallback(ctx.window, char_callback);
+    glfwSetWindowFocusCallback(ctx.window, window_focus_callback);
+    glfwSetCursorEnterCallback(ctx.window, cursor_enter_callback);
+    glfwSetWindowRefreshCallback(ctx.window, window_refresh_callback);
 
     bgfx::Init init;
 
@@ -402,6 +1799,8 @@ int main() {
     bgfx::setViewName(VIEW_COPY_TO_FRAMEBUFFER, "VIEW_COPY_TO_FRAMEBUFFER");
     bgfx::setViewName(VIEW_BLIT, "VIEW_BLIT");
     bgfx::setViewName(VIEW_IMGUI, "VIEW_IMGUI");
+    // Quads overlap with blending, they must be drawn exactly in submission order.
+    bgfx::setViewMode(VIEW_RENDER, bgfx::ViewMode::Sequential);
     const PosTexcoordVertex quad_vertices[] = {{-1.0f, -1.0f, 0.0f, 0.0f, 0.0f},
                                                {1.0f, -1.0f, 0.0f, 1.0f, 0.0f},
                                                {-1.0f, 1.0f, 0.0f, 0.0f, 1.0f},
@@ -417,72 +1816,77 @@ int main() {
     ctx.vertex_shader_handle = bgfx::createShader(bgfx::makeRef(quad_vertex, sizeof(quad_vertex)));
     ctx.fragment_shader_handle =
         bgfx::createShader(bgfx::makeRef(quad_fragment, sizeof(quad_fragment)));
-    ctx.program = bgfx::createProgram(ctx.vertex_shader_handle, ctx.fragment_shader_handle, true);
+    ctx.program = bgfx::createProgram(ctx.vertex_shader_handle, ctx.fragment_shader_handle, false);
+    ctx.instanced_vertex_shader_handle = bgfx::createShader(
+        bgfx::makeRef(quad_instanced_vertex, sizeof(quad_instanced_vertex)));
+    ctx.instanced_program = bgfx::createProgram(ctx.instanced_vertex_shader_handle,
+                                                ctx.fragment_shader_handle, false);
 
     ctx.view = glm::lookAt(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 0.0f),
                            glm::vec3(0.0f, 1.0f, 0.0f));
     ctx.aspect_ratio = float(ctx.window_width) / float(ctx.window_height);
 
-    ctx.quads.push_back(Quad{.position = glm::vec3(1, 0, 0),
-                             .aspect_ratio = 1.0,
-                             .filename = "assets/guts.png",
-                             .z_index = 0});
-
-    ctx.quads.push_back(Quad{.position = glm::vec3(0, 0, 0),
-                             .aspect_ratio = 1.0,
-                             .filename = "assets/logo.png",
-                             .z_index = 1});
-
-    ctx.quads.push_back(Quad{.position = glm::vec3(0, 0, 0),
-                             .aspect_ratio = 1.0,
-                             .filename = "assets/wordart.png",
-                             .z_index = 2});
-
     ctx.uniform_handle = bgfx::createUniform("texture_uniform", bgfx::UniformType::Sampler);
-
-    for (auto& quad : ctx.quads) {
-        int texture_width, texture_height, channels;
-        stbi_set_flip_vertically_on_load(true);
-        unsigned char* data =
-            stbi_load(quad.filename.c_str(), &texture_width, &texture_height, &channels, 4);
-        if (!data) {
-            printf("[error] couldn't load logo.png\n");
-            return -1;
+    ctx.uv_rect_uniform_handle = bgfx::createUniform("u_uv_rect", bgfx::UniformType::Vec4);
+    ctx.texture_page_uniform_handle =
+        bgfx::createUniform("u_texture_page", bgfx::UniformType::Vec4);
+    placeholders_create();
+    ctx.texture_compression = texture_compression_choose(TEXTURE_COMPRESSION_DEFAULT_PRESET);
+#ifndef EMSCRIPTEN
+    texture_cache_open(ctx.texture_cache, texture_cache_default_directory());
+    ctx.image_loader.cache = &ctx.texture_cache;
+#endif
+    // Images larger than a texture can hold are streamed as tiles instead of decoded whole. The
+    // workers wake the frame loop whenever an image is ready.
+    image_loader_start(ctx.image_loader,
+                       std::min(TILED_IMAGE_MIN_SIZE, int(bgfx::getCaps()->limits.maxTextureSize)),
+                       []() { glfwPostEmptyEvent(); });
+
+    // A session on the board that didn't exit cleanly is restored from its autosave. Otherwise a
+    // board given on the command line is opened, or the demo board is shown.
+    if (argc > 1) {
+        ctx.board_path = argv[1];
+    }
+    autosave_start(ctx.autosave, ctx.board_path);
+    image_index_load(ctx.image_index, (ctx.board_path + ".index").c_str());
+    if (!autosave_recover()) {
+        if (argc > 1) {
+            if (!board_load(argv[1])) {
+                autosave_stop(ctx.autosave);
+                return -1;
+            }
+        } else {
+            quad_request_probe(quad_add(glm::vec2(1, 0), "assets/guts.png").index);
+            quad_request_probe(quad_add(glm::vec2(0, 0), "assets/logo.png").index);
+            quad_request_probe(quad_add(glm::vec2(0, 0), "assets/wordart.png").index);
+            autosave_take_snapshot();
         }
-
-        quad.cpu_texture_data = data;
-        quad.texture_width = texture_width;
-        quad.texture_height = texture_height;
-        bgfx::TextureHandle texture_handle = bgfx::createTexture2D(
-            texture_width, texture_height, false, 1, bgfx::TextureFormat::RGBA8, 0, NULL);
-        bgfx::updateTexture2D(
-            texture_handle, 0, 0, 0, 0, texture_width, texture_height,
-            bgfx::copy(quad.cpu_texture_data, texture_width * texture_height * 4));
-        quad.texture_handle = texture_handle;
-        quad.texture_size = glm::vec2(texture_width, texture_height);
     }
 
-    ctx.render_texture_handle =
-        bgfx::createTexture2D(ctx.window_width, ctx.window_height, false, 1,
-                              bgfx::TextureFormat::RGBA8, BGFX_TEXTURE_RT, NULL);
-
-    bgfx::TextureHandle framebuffer_textures[] = {ctx.render_texture_handle};
-
-    ctx.framebuffer_handle =
-        bgfx::createFrameBuffer(BX_COUNTOF(framebuffer_textures), framebuffer_textures, true);
-    ctx.readback_texture_handle = bgfx::createTexture2D(
-        ctx.window_width, ctx.window_height, false, 1, bgfx::TextureFormat::RGBA8,
-        BGFX_TEXTURE_READ_BACK | BGFX_TEXTURE_BLIT_DST, NULL);
-    ctx.pixels = std::vector<uint8_t>(ctx.window_width * ctx.window_height * 4);
-
 #ifdef EMSCRIPTEN
     emscripten_set_main_loop(emscripten_main_loop_wrapper, 0, true);
 #else
     while (!glfwWindowShouldClose(ctx.window)) {
+        // Sleep until the next input event instead of redrawing an unchanged board at vsync.
+        if (!redraw_pending()) {
+            glfwWaitEvents();
+        }
         main_loop();
     }
 #endif
 
+    image_loader_stop(ctx.image_loader);
+    autosave_stop(ctx.autosave);
+    // The open board may be the snapshot, which can't be deleted while mapped.
+    board_file_close(ctx.board_file);
+    // Edits that weren't saved only exist in the autosave, the next start restores them from it.
+    // Otherwise it opens the board itself rather than this session's autosave.
+    if (!ctx.board_modified) {
+        autosave_discard(ctx.autosave);
+    }
+    if (ctx.image_index.dirty) {
+        image_index_save(ctx.image_index, (ctx.board_path + ".index").c_str());
+    }
     ImGui_Implbgfx_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPMAPS_SSE2 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define MIPMAPS_WASM_SIMD 1
+#endif
+
+int mip_level_size(int size, int level) {
+    int s = size >> level;
+    return s > 0 ? s : 1;
+}
+
+int mip_level_count(int width, int height) {
+    int count = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        count++;
+    }
+    return count;
+}
+
+#if MIPMAPS_SSE2
+// Rounded 2x2 averages of the four pixels in each of row0 and row1, widened to 16 bits so the
+// result matches the scalar (a + b + c + d + 2) >> 2 instead of rounding up twice.
+__m128i mip_box_2x2_sse2(const uint8_t* row0, const uint8_t* row1) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i r0 = _mm_loadu_si128((const __m128i*)row0);
+    __m128i r1 = _mm_loadu_si128((const __m128i*)row1);
+    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(r0, zero), _mm_unpacklo_epi8(r1, zero));
+    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(r0, zero), _mm_unpackhi_epi8(r1, zero));
+    __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+}
+#elif MIPMAPS_WASM_SIMD
+v128_t mip_box_2x2_wasm(const uint8_t* row0, const uint8_t* row1) {
+    v128_t r0 = wasm_v128_load(row0);
+    v128_t r1 = wasm_v128_load(row1);
+    v128_t lo = wasm_i16x8_add(wasm_u16x8_extend_low_u8x16(r0), wasm_u16x8_extend_low_u8x16(r1));
+    v128_t hi =
+        wasm_i16x8_add(wasm_u16x8_extend_high_u8x16(r0), wasm_u16x8_extend_high_u8x16(r1));
+    v128_t sum = wasm_i16x8_add(wasm_i64x2_shuffle(lo, hi, 0, 2), wasm_i64x2_shuffle(lo, hi, 1, 3));
+    return wasm_u16x8_shr(wasm_i16x8_add(sum, wasm_i16x8_splat(2)), 2);
+}
+#endif
+
+// 2x2 box filter of an RGBA8 image into the next level. Sizes follow the GL floor convention, a
+// source row or column of 1 is clamped instead of read past the edge. The SIMD and scalar paths
+// give identical results; use_simd only exists so that can be checked.
+void mip_downsample_rgba8(const uint8_t* src, int src_width, int src_height, uint8_t* dst,
+                          bool use_simd = true) {
+    int dst_width = mip_level_size(src_width, 1);
+    int dst_height = mip_level_size(src_height, 1);
+    size_t src_stride = size_t(src_width) * 4;
+
+    for (int y = 0; y < dst_height; y++) {
+        const uint8_t* row0 = src + size_t(y * 2) * src_stride;
+        const uint8_t* row1 = src_height > 1 ? row0 + src_stride : row0;
+        uint8_t* out = dst + size_t(y) * dst_width * 4;
+        int x = 0;
+
+        if (use_simd && src_width > 1) {
+#if MIPMAPS_SSE2
+            for (; x + 4 <= dst_width; x += 4) {
+                __m128i a = mip_box_2x2_sse2(row0 + x * 8, row1 + x * 8);
+                __m128i b = mip_box_2x2_sse2(row0 + x * 8 + 16, row1 + x * 8 + 16);
+                _mm_storeu_si128((__m128i*)(out + x * 4), _mm_packus_epi16(a, b));
+            }
+#elif MIPMAPS_WASM_SIMD
+            for (; x + 4 <= dst_width; x += 4) {
+                v128_t a = mip_box_2x2_wasm(row0 + x * 8, row1 + x * 8);
+                v128_t b = mip_box_2x2_wasm(row0 + x * 8 + 16, row1 + x * 8 + 16);
+                wasm_v128_store(out + x * 4, wasm_u8x16_narrow_i16x8(a, b));
+            }
+#endif
+        }
+
+        for (; x < dst_width; x++) {
+            int x0 = x * 2;
+            int x1 = src_width > 1 ? x0 + 1 : x0;
+            for (int c = 0; c < 4; c++) {
+                int sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] +
+                          row1[x1 * 4 + c];
+                out[x * 4 + c] = uint8_t((sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+// Halves an RGBA8 image with the box filter above until neither side is larger than max_size,
+// leaving the result in reduced and its size in width and height. Returns the number of halvings,
+// reduced is untouched when the image already fits.
+int mip_reduce_to_fit(const uint8_t* pixels, int& width, int& height, int max_size,
+                      std::vector<uint8_t>& reduced) {
+    int halvings = 0;
+    std::vector<uint8_t> scratch;
+    const uint8_t* src = pixels;
+    while (width > max_size || height > max_size) {
+        int reduced_width = mip_level_size(width, 1);
+        int reduced_height = mip_level_size(height, 1);
+        scratch.resize(size_t(reduced_width) * reduced_height * 4);
+        mip_downsample_rgba8(src, width, height, scratch.data());
+        reduced.swap(scratch);
+        src = reduced.data();
+        width = reduced_width;
+        height = reduced_height;
+        halvings++;
+    }
+    return halvings;
+}
+
+// Fills chain with levels 0..level_count-1 back to back, level 0 being a copy of pixels.
+// offsets[level] is where each level starts.
+void mip_build_chain(const uint8_t* pixels, int width, int height, int level_count,
+                     std::vector<uint8_t>& chain, std::vector<size_t>& offsets) {
+    offsets.resize(level_count);
+    size_t total = 0;
+    for (int level = 0; level < level_count; level++) {
+        offsets[level] = total;
+        total += size_t(mip_level_size(width, level)) * mip_level_size(height, level) * 4;
+    }
+    chain.resize(total);
+    memcpy(chain.data(), pixels, size_t(width) * height * 4);
+
+    for (int level = 1; level < level_count; level++) {
+        mip_downsample_rgba8(chain.data() + offsets[level - 1], mip_level_size(width, level - 1),
+                             mip_level_size(height, level - 1), chain.data() + offsets[level]);
+    }
+}
@@ -1,6 +1,6 @@
-static const uint8_t quad_fragment[1819] =
+static const uint8_t quad_fragment[2150] =
 {
-	0x46, 0x53, 0x48, 0x0b, 0x6f, 0x1e, 0x3e, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x07, // FSH.o.><........
+	0x46, 0x53, 0x48, 0x0b, 0x6f, 0x1e, 0x3e, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x53, 0x08, // FSH.o.><......S.
 	0x00, 0x00, 0x23, 0x76, 0x65, 0x72, 0x73, 0x69, 0x6f, 0x6e, 0x20, 0x33, 0x32, 0x30, 0x20, 0x65, // ..#version 320 e
 	0x73, 0x0a, 0x23, 0x64, 0x65, 0x66, 0x69, 0x6e, 0x65, 0x20, 0x61, 0x74, 0x74, 0x72, 0x69, 0x62, // s.#define attrib
 	0x75, 0x74, 0x65, 0x20, 0x69, 0x6e, 0x0a, 0x23, 0x64, 0x65, 0x66, 0x69, 0x6e, 0x65, 0x20, 0x76, // ute in.#define v
@@ -109,9 +109,30 @@ static const uint8_t quad_fragment[1819] =
 	0x0a, 0x75, 0x6e, 0x69, 0x66, 0x6f, 0x72, 0x6d, 0x20, 0x76, 0x65, 0x63, 0x34, 0x20, 0x75, 0x5f, // .uniform vec4 u_
 	0x61, 0x6c, 0x70, 0x68, 0x61, 0x52, 0x65, 0x66, 0x34, 0x3b, 0x0a, 0x75, 0x6e, 0x69, 0x66, 0x6f, // alphaRef4;.unifo
 	0x72, 0x6d, 0x20, 0x73, 0x61, 0x6d, 0x70, 0x6c, 0x65, 0x72, 0x32, 0x44, 0x20, 0x73, 0x5f, 0x74, // rm sampler2D s_t
-	0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x3b, 0x0a, 0x76, 0x6f, 0x69, 0x64, 0x20, 0x6d, 0x61, 0x69, // exture;.void mai
-	0x6e, 0x28, 0x29, 0x0a, 0x7b, 0x0a, 0x62, 0x67, 0x66, 0x78, 0x5f, 0x46, 0x72, 0x61, 0x67, 0x43, // n().{.bgfx_FragC
-	0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x3d, 0x20, 0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x28, 0x73, // olor = texture(s
-	0x5f, 0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x2c, 0x20, 0x76, 0x5f, 0x74, 0x65, 0x78, 0x63, // _texture, v_texc
-	0x6f, 0x6f, 0x72, 0x64, 0x30, 0x29, 0x3b, 0x0a, 0x7d, 0x0a, 0x00,                               // oord0);.}..
+	0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x3b, 0x0a, 0x75, 0x6e, 0x69, 0x66, 0x6f, 0x72, 0x6d, 0x20, // exture;.uniform 
+	0x76, 0x65, 0x63, 0x34, 0x20, 0x75, 0x5f, 0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x5f, 0x70, // vec4 u_texture_p
+	0x61, 0x67, 0x65, 0x3b, 0x0a, 0x76, 0x6f, 0x69, 0x64, 0x20, 0x6d, 0x61, 0x69, 0x6e, 0x28, 0x29, // age;.void main()
+	0x0a, 0x7b, 0x0a, 0x76, 0x65, 0x63, 0x32, 0x20, 0x74, 0x65, 0x78, 0x65, 0x6c, 0x20, 0x3d, 0x20, // .{.vec2 texel = 
+	0x76, 0x5f, 0x74, 0x65, 0x78, 0x63, 0x6f, 0x6f, 0x72, 0x64, 0x30, 0x20, 0x2a, 0x20, 0x75, 0x5f, // v_texcoord0 * u_
+	0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x5f, 0x70, 0x61, 0x67, 0x65, 0x2e, 0x78, 0x79, 0x3b, // texture_page.xy;
+	0x0a, 0x76, 0x65, 0x63, 0x32, 0x20, 0x64, 0x78, 0x20, 0x3d, 0x20, 0x64, 0x46, 0x64, 0x78, 0x28, // .vec2 dx = dFdx(
+	0x74, 0x65, 0x78, 0x65, 0x6c, 0x29, 0x3b, 0x0a, 0x76, 0x65, 0x63, 0x32, 0x20, 0x64, 0x79, 0x20, // texel);.vec2 dy 
+	0x3d, 0x20, 0x64, 0x46, 0x64, 0x79, 0x28, 0x74, 0x65, 0x78, 0x65, 0x6c, 0x29, 0x3b, 0x0a, 0x66, // = dFdy(texel);.f
+	0x6c, 0x6f, 0x61, 0x74, 0x20, 0x6c, 0x6f, 0x64, 0x20, 0x3d, 0x20, 0x30, 0x2e, 0x35, 0x20, 0x2a, // loat lod = 0.5 *
+	0x20, 0x6c, 0x6f, 0x67, 0x32, 0x28, 0x6d, 0x61, 0x78, 0x28, 0x64, 0x6f, 0x74, 0x28, 0x64, 0x78, //  log2(max(dot(dx
+	0x2c, 0x20, 0x64, 0x78, 0x29, 0x2c, 0x20, 0x64, 0x6f, 0x74, 0x28, 0x64, 0x79, 0x2c, 0x20, 0x64, // , dx), dot(dy, d
+	0x79, 0x29, 0x29, 0x29, 0x3b, 0x0a, 0x76, 0x65, 0x63, 0x34, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, // y)));.vec4 color
+	0x20, 0x3d, 0x20, 0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x4c, 0x6f, 0x64, 0x28, 0x73, 0x5f, //  = textureLod(s_
+	0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x2c, 0x20, 0x76, 0x5f, 0x74, 0x65, 0x78, 0x63, 0x6f, // texture, v_texco
+	0x6f, 0x72, 0x64, 0x30, 0x2c, 0x20, 0x63, 0x6c, 0x61, 0x6d, 0x70, 0x28, 0x6c, 0x6f, 0x64, 0x2c, // ord0, clamp(lod,
+	0x20, 0x30, 0x2e, 0x30, 0x2c, 0x20, 0x75, 0x5f, 0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x5f, //  0.0, u_texture_
+	0x70, 0x61, 0x67, 0x65, 0x2e, 0x7a, 0x29, 0x29, 0x3b, 0x0a, 0x69, 0x66, 0x20, 0x28, 0x75, 0x5f, // page.z));.if (u_
+	0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x5f, 0x70, 0x61, 0x67, 0x65, 0x2e, 0x77, 0x20, 0x3e, // texture_page.w >
+	0x20, 0x30, 0x2e, 0x35, 0x29, 0x0a, 0x7b, 0x0a, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x3d, 0x20, //  0.5).{.color = 
+	0x76, 0x65, 0x63, 0x34, 0x28, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x2e, 0x72, 0x72, 0x72, 0x2c, 0x20, // vec4(color.rrr, 
+	0x75, 0x5f, 0x74, 0x65, 0x78, 0x74, 0x75, 0x72, 0x65, 0x5f, 0x70, 0x61, 0x67, 0x65, 0x2e, 0x77, // u_texture_page.w
+	0x20, 0x3e, 0x20, 0x31, 0x2e, 0x35, 0x20, 0x3f, 0x20, 0x63, 0x6f, 0x6c, 0x6f, 0x72, 0x2e, 0x67, //  > 1.5 ? color.g
+	0x20, 0x3a, 0x20, 0x31, 0x2e, 0x30, 0x29, 0x3b, 0x0a, 0x7d, 0x0a, 0x62, 0x67, 0x66, 0x78, 0x5f, //  : 1.0);.}.bgfx_
+	0x46, 0x72, 0x61, 0x67, 0x43, 0x6f, 0x6c, 0x6f, 0x72, 0x20, 0x3d, 0x20, 0x63, 0x6f, 0x6c, 0x6f, // FragColor = colo
+	0x72, 0x3b, 0x0a, 0x7d, 0x0a, 0x00,                                                             // r;.}..
 };
@@ -4,7 +4,20 @@ $input v_texcoord0
 
 SAMPLER2D(s_texture, 0);
 
+// xy: page size in texels, z: highest mip level filled for this page, w: 1 when the page holds
+// gray in its first channel, 2 when it holds gray and alpha in its first two
+uniform vec4 u_texture_page;
+
 void main()
 {
-	gl_FragColor = texture2D(s_texture, v_texcoord0);
+	vec2 texel = v_texcoord0 * u_texture_page.xy;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+	vec4 color = texture2DLod(s_texture, v_texcoord0, clamp(lod, 0.0, u_texture_page.z));
+	if (u_texture_page.w > 0.5)
+	{
+		color = vec4(color.rrr, u_texture_page.w > 1.5 ? color.g : 1.0);
+	}
+	gl_FragColor = color;
 }
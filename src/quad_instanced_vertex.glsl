@@ -0,0 +1,12 @@
+$input a_position, a_texcoord0, i_data0, i_data1, i_data2, i_data3
+$output v_texcoord0
+
+#include <bgfx_shader.sh>
+
+void main()
+{
+	vec2 local = mix(i_data3.xy, i_data3.zw, a_texcoord0);
+	vec3 position = vec3(local * i_data1.xy, 0.0) + i_data0.xyz;
+	gl_Position = mul(u_viewProj, vec4(position, 1.0) );
+	v_texcoord0 = mix(i_data2.xy, i_data2.zw, a_texcoord0);
+}
@@ -3,8 +3,10 @@ $output v_texcoord0
 
 #include <bgfx_shader.sh>
 
+uniform vec4 u_uv_rect;
+
 void main()
 {
 	gl_Position = mul(u_modelViewProj, vec4(a_position, 1.0) );
-	v_texcoord0 = a_texcoord0;
+	v_texcoord0 = mix(u_uv_rect.xy, u_uv_rect.zw, a_texcoord0);
 }
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "mipmaps.h"
+#include "texture_pages.h"
+
+#define RESIDENCY_DEFAULT_BUDGET_MB 512
+// Every image keeps at least the level whose largest side fits in this, so it can always be drawn.
+#define RESIDENCY_THUMBNAIL_SIZE 64
+// Levels an image may be more detailed than needed before detail is dropped, avoids thrashing
+// when the zoom hovers around a level boundary.
+#define RESIDENCY_HYSTERESIS 1
+#define RESIDENCY_UPLOAD_BYTES_PER_FRAME (32 << 20)
+
+// An image and the mip level of it that currently lives in the texture pages. The CPU side keeps
+// the whole chain so any level can be streamed in without decoding again.
+struct ResidentImage {
+    std::vector<uint8_t> mips;
+    std::vector<size_t> mip_offsets;
+    // Every level of an image in another format than RGBA8 prepared for the pages, held instead of
+    // mips.
+    std::vector<TextureUpload> uploads;
+    int width = 0;
+    int height = 0;
+    int thumbnail_level = 0;
+    int resident_level = -1;
+    int wanted_level = 0;
+    int texture_entry = -1;
+    uint32_t last_used_frame = 0;
+    bool detailed = false;
+    bool alive = false;
+};
+
+struct Residency {
+    std::vector<ResidentImage> images;
+    std::vector<int> free_images;
+    size_t budget_bytes = size_t(RESIDENCY_DEFAULT_BUDGET_MB) << 20;
+    size_t resident_bytes = 0;
+    uint32_t frame = 0;
+    // Images drawn this frame, and images resident above their thumbnail level.
+    std::vector<int> requests;
+    std::vector<int> detailed;
+    // Set when the per-frame upload limit held back detail, another frame is needed.
+    bool pending = false;
+};
+
+int residency_level_count(const ResidentImage& image) {
+    return int(image.uploads.empty() ? image.mip_offsets.size() : image.uploads.size());
+}
+
+size_t residency_level_bytes(const ResidentImage& image, int level) {
+    if (!image.uploads.empty()) return image.uploads[level].data.size();
+    size_t bytes = size_t(mip_level_size(image.width, level)) *
+                   mip_level_size(image.height, level) * 4;
+    return bytes + bytes / 3;
+}
+
+void residency_set_level(Residency& res, TexturePages& tp, int image_index, int level) {
+    ResidentImage& image = res.images[image_index];
+    const uint8_t* pixels = image.uploads.empty() ? image.mips.data() + image.mip_offsets[level]
+                                                  : nullptr;
+    const TextureUpload* upload = image.uploads.empty() ? nullptr : &image.uploads[level];
+    int width = mip_level_size(image.width, level);
+    int height = mip_level_size(image.height, level);
+
+    if (image.texture_entry < 0) {
+        image.texture_entry = texture_pages_add(tp, pixels, width, height, upload);
+    } else {
+        res.resident_bytes -= residency_level_bytes(image, image.resident_level);
+        texture_pages_resize(tp, image.texture_entry, pixels, width, height, upload);
+    }
+    res.resident_bytes += residency_level_bytes(image, level);
+    image.resident_level = level;
+
+    if (level < image.thumbnail_level && !image.detailed) {
+        image.detailed = true;
+        res.detailed.push_back(image_index);
+    }
+}
+
+// Takes over a mip chain built by mip_build_chain, or the uploads prepared from one, and makes its
+// thumbnail level resident.
+int residency_add_chain(Residency& res, TexturePages& tp, std::vector<uint8_t>&& mips,
+                        std::vector<size_t>&& mip_offsets, std::vector<TextureUpload>&& uploads,
+                        int width, int height) {
+    int image_index;
+    if (!res.free_images.empty()) {
+        image_index = res.free_images.back();
+        res.free_images.pop_back();
+    } else {
+        image_index = int(res.images.size());
+        res.images.emplace_back();
+    }
+
+    ResidentImage& image = res.images[image_index];
+    image = ResidentImage{.mips = std::move(mips),
+                          .mip_offsets = std::move(mip_offsets),
+                          .uploads = std::move(uploads),
+                          .width = width,
+                          .height = height,
+                          .alive = true};
+    int level_count = residency_level_count(image);
+
+    while (image.thumbnail_level < level_count - 1 &&
+           std::max(mip_level_size(width, image.thumbnail_level),
+                    mip_level_size(height, image.thumbnail_level)) > RESIDENCY_THUMBNAIL_SIZE) {
+        image.thumbnail_level++;
+    }
+    image.wanted_level = image.thumbnail_level;
+    residency_set_level(res, tp, image_index, image.thumbnail_level);
+    return image_index;
+}
+
+// Takes a copy of an RGBA8 image, builds its mip chain and makes the thumbnail level resident.
+int residency_add(Residency& res, TexturePages& tp, const uint8_t* pixels, int width, int height) {
+    std::vector<uint8_t> mips;
+    std::vector<size_t> mip_offsets;
+    mip_build_chain(pixels, width, height, mip_level_count(width, height), mips, mip_offsets);
+    return residency_add_chain(res, tp, std::move(mips), std::move(mip_offsets), {}, width, height);
+}
+
+// CPU memory the image holds on to.
+size_t residency_image_bytes(const ResidentImage& image) {
+    size_t bytes = image.mips.size();
+    for (const TextureUpload& upload : image.uploads) {
+        bytes += upload.data.size();
+    }
+    return bytes;
+}
+
+void residency_remove(Residency& res, TexturePages& tp, int image_index) {
+    ResidentImage& image = res.images[image_index];
+    if (!image.alive) return;
+
+    texture_pages_remove(tp, image.texture_entry);
+    res.resident_bytes -= residency_level_bytes(image, image.resident_level);
+    image = ResidentImage{};
+    res.free_images.push_back(image_index);
+}
+
+// Records that the image is drawn this frame with texels_per_pixel source texels across each
+// screen pixel, the level that matches it is what residency_update aims for.
+void residency_request(Residency& res, int image_index, float texels_per_pixel) {
+    ResidentImage& image = res.images[image_index];
+    int level = texels_per_pixel > 1.0f ? int(floorf(log2f(texels_per_pixel))) : 0;
+    image.wanted_level = std::min(level, image.thumbnail_level);
+    image.last_used_frame = res.frame;
+    res.requests.push_back(image_index);
+}
+
+// Drops detail nobody looks at and streams in the levels asked for this frame, biggest upgrades
+// first, within the VRAM budget and a per-frame upload limit.
+void residency_update(Residency& res, TexturePages& tp) {
+    res.pending = false;
+
+    std::vector<int> upgrades;
+    for (int image_index : res.requests) {
+        ResidentImage& image = res.images[image_index];
+        if (!image.alive) continue;
+        if (image.wanted_level > image.resident_level + RESIDENCY_HYSTERESIS) {
+            residency_set_level(res, tp, image_index, image.wanted_level);
+        } else if (image.wanted_level < image.resident_level) {
+            upgrades.push_back(image_index);
+        }
+    }
+    res.requests.clear();
+
+    std::sort(upgrades.begin(), upgrades.end(), [&](int a, int b) {
+        return residency_level_bytes(res.images[a], res.images[a].wanted_level) >
+               residency_level_bytes(res.images[b], res.images[b].wanted_level);
+    });
+
+    // Least recently drawn first, only images not drawn this frame can be evicted.
+    size_t kept = 0;
+    for (int image_index : res.detailed) {
+        ResidentImage& image = res.images[image_index];
+        image.detailed = image.alive && image.resident_level < image.thumbnail_level;
+        if (image.detailed) res.detailed[kept++] = image_index;
+    }
+    res.detailed.resize(kept);
+    std::sort(res.detailed.begin(), res.detailed.end(), [&](int a, int b) {
+        return res.images[a].last_used_frame < res.images[b].last_used_frame;
+    });
+    size_t next_eviction = 0;
+
+    size_t uploaded = 0;
+    for (int image_index : upgrades) {
+        ResidentImage& image = res.images[image_index];
+        size_t growth = residency_level_bytes(image, image.wanted_level) -
+                        residency_level_bytes(image, image.resident_level);
+
+        while (res.resident_bytes + growth > res.budget_bytes &&
+               next_eviction < res.detailed.size()) {
+            int evicted_index = res.detailed[next_eviction];
+            ResidentImage& evicted = res.images[evicted_index];
+            if (evicted.last_used_frame == res.frame) break;
+            next_eviction++;
+            if (evicted.resident_level < evicted.thumbnail_level) {
+                residency_set_level(res, tp, evicted_index, evicted.thumbnail_level);
+            }
+        }
+        // Over budget with nothing left to evict, this one waits until the view changes.
+        if (res.resident_bytes + growth > res.budget_bytes) continue;
+        if (uploaded > 0 && uploaded + growth > RESIDENCY_UPLOAD_BYTES_PER_FRAME) {
+            res.pending = true;
+            break;
+        }
+        uploaded += growth;
+        residency_set_level(res, tp, image_index, image.wanted_level);
+    }
+
+    res.frame++;
+}
@@ -0,0 +1,1056 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+// Decoders that hand out an image one RGBA8 row at a time, top row first, so an image never has
+// to exist whole in memory. They cover non-interlaced PNG and baseline JPEG, the formats large
+// scans come in. A JPEG can also be decoded at 1/2, 1/4 or 1/8 scale straight from its DCT
+// coefficients. Interlaced PNGs, progressive, arithmetic coded or CMYK JPEGs are refused when
+// opened and left to stb_image.
+
+#define BYTE_SOURCE_BUFFER_SIZE (64 * 1024)
+
+// Buffered reads from a file, or from memory already holding the whole file.
+struct ByteSource {
+    FILE* file = nullptr;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t position = 0;
+    std::vector<uint8_t> buffer;
+};
+
+void byte_source_open_file(ByteSource& source, FILE* file) {
+    source = ByteSource{};
+    source.file = file;
+    source.buffer.resize(BYTE_SOURCE_BUFFER_SIZE);
+    source.data = source.buffer.data();
+}
+
+void byte_source_open_memory(ByteSource& source, const uint8_t* data, size_t size) {
+    source = ByteSource{};
+    source.data = data;
+    source.size = size;
+}
+
+// The next byte, -1 past the end.
+int byte_source_get(ByteSource& source) {
+    if (source.position == source.size) {
+        if (!source.file) return -1;
+        source.size = fread(source.buffer.data(), 1, source.buffer.size(), source.file);
+        source.position = 0;
+        if (source.size == 0) return -1;
+    }
+    return source.data[source.position++];
+}
+
+bool byte_source_read(ByteSource& source, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        int byte = byte_source_get(source);
+        if (byte < 0) return false;
+        out[i] = uint8_t(byte);
+    }
+    return true;
+}
+
+bool byte_source_skip(ByteSource& source, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (byte_source_get(source) < 0) return false;
+    }
+    return true;
+}
+
+uint32_t row_decoders_be32(const uint8_t* bytes) {
+    return uint32_t(bytes[0]) << 24 | uint32_t(bytes[1]) << 16 | uint32_t(bytes[2]) << 8 |
+           bytes[3];
+}
+
+int row_decoders_be16(const uint8_t* bytes) { return bytes[0] << 8 | bytes[1]; }
+
+uint8_t row_decoders_clamp(float value) {
+    return value <= 0.0f ? 0 : value >= 255.0f ? 255 : uint8_t(value);
+}
+
+// PNG
+
+#define INFLATE_FAST_BITS 9
+#define INFLATE_WINDOW_SIZE 32768
+
+// Canonical Huffman code of a deflate block. Codes up to INFLATE_FAST_BITS long are looked up
+// directly, the rest are walked one bit at a time.
+struct InflateHuffman {
+    // (length << 9) | symbol, 0 where the code is longer.
+    uint16_t fast[1 << INFLATE_FAST_BITS];
+    uint16_t first_code[16];
+    uint16_t first_symbol[16];
+    uint16_t count[16];
+    uint16_t symbols[288];
+};
+
+// Where a deflate stream stopped, so it can carry on when the next row is asked for.
+struct Inflate {
+    uint32_t bits = 0;
+    int bit_count = 0;
+    std::vector<uint8_t> window;
+    uint64_t position = 0;
+    // -1 between blocks, otherwise the type of the current one.
+    int block_type = -1;
+    bool final_block = false;
+    uint32_t stored_remaining = 0;
+    int copy_length = 0;
+    int copy_distance = 0;
+    InflateHuffman literals;
+    InflateHuffman distances;
+};
+
+struct PngRowDecoder {
+    ByteSource source;
+    int width = 0;
+    int height = 0;
+    int depth = 0;
+    int color_type = 0;
+    int channels = 0;
+    // Bytes per pixel as the filters see them, at least one.
+    int filter_stride = 0;
+    uint8_t palette[256][4];
+    bool has_transparency = false;
+    uint16_t transparent[3] = {};
+    // Bytes left in the current IDAT chunk, the zlib stream continues in the next one.
+    uint32_t idat_remaining = 0;
+    bool idat_ended = false;
+    Inflate inflate;
+    std::vector<uint8_t> row;
+    std::vector<uint8_t> previous_row;
+    int next_row = 0;
+};
+
+bool inflate_huffman_build(InflateHuffman& huffman, const uint8_t* lengths, int count) {
+    memset(&huffman, 0, sizeof(huffman));
+    for (int i = 0; i < count; i++) huffman.count[lengths[i]]++;
+    huffman.count[0] = 0;
+
+    int code = 0;
+    int symbol = 0;
+    uint16_t next_symbol[16];
+    for (int length = 1; length < 16; length++) {
+        huffman.first_code[length] = uint16_t(code);
+        huffman.first_symbol[length] = uint16_t(symbol);
+        next_symbol[length] = uint16_t(symbol);
+        code += huffman.count[length];
+        symbol += huffman.count[length];
+        if (code > (1 << length)) return false;
+        code <<= 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int length = lengths[i];
+        if (length == 0) continue;
+        int rank = next_symbol[length]++;
+        huffman.symbols[rank] = uint16_t(i);
+        if (length > INFLATE_FAST_BITS) continue;
+
+        // Deflate sends codes most significant bit first into a stream read from the bottom.
+        int code = huffman.first_code[length] + rank - huffman.first_symbol[length];
+        int reversed = 0;
+        for (int b = 0; b < length; b++) reversed |= ((code >> b) & 1) << (length - 1 - b);
+        for (int j = reversed; j < (1 << INFLATE_FAST_BITS); j += 1 << length) {
+            huffman.fast[j] = uint16_t(length << 9 | i);
+        }
+    }
+    return true;
+}
+
+// The next byte of the zlib stream, which is split over consecutive IDAT chunks.
+int png_rows_idat_byte(PngRowDecoder& png) {
+    while (png.idat_remaining == 0) {
+        // CRC of the chunk before, then the length and type of the next.
+        uint8_t header[12];
+        if (png.idat_ended || !byte_source_read(png.source, header, 12) ||
+            memcmp(header + 8, "IDAT", 4) != 0) {
+            png.idat_ended = true;
+            return -1;
+        }
+        png.idat_remaining = row_decoders_be32(header + 4);
+    }
+    png.idat_remaining--;
+    return byte_source_get(png.source);
+}
+
+bool png_inflate_fill(PngRowDecoder& png, int count) {
+    Inflate& z = png.inflate;
+    while (z.bit_count < count) {
+        int byte = png_rows_idat_byte(png);
+        if (byte < 0) return false;
+        z.bits |= uint32_t(byte) << z.bit_count;
+        z.bit_count += 8;
+    }
+    return true;
+}
+
+// count bits, least significant first, -1 when the stream ends early.
+int png_inflate_bits(PngRowDecoder& png, int count) {
+    Inflate& z = png.inflate;
+    if (!png_inflate_fill(png, count)) return -1;
+    int value = int(z.bits & ((1u << count) - 1));
+    z.bits >>= count;
+    z.bit_count -= count;
+    return value;
+}
+
+int png_inflate_decode(PngRowDecoder& png, const InflateHuffman& huffman) {
+    Inflate& z = png.inflate;
+    // The last code of the stream can be shorter than what is peeked, the missing bits read as 0.
+    png_inflate_fill(png, INFLATE_FAST_BITS);
+    uint16_t entry = huffman.fast[z.bits & ((1 << INFLATE_FAST_BITS) - 1)];
+    if (entry) {
+        int length = entry >> 9;
+        if (length > z.bit_count) return -1;
+        z.bits >>= length;
+        z.bit_count -= length;
+        return entry & 511;
+    }
+
+    int code = 0;
+    for (int length = 1; length < 16; length++) {
+        int bit = png_inflate_bits(png, 1);
+        if (bit < 0) return -1;
+        code = code << 1 | bit;
+        int index = code - huffman.first_code[length];
+        if (index >= 0 && index < huffman.count[length]) {
+            return huffman.symbols[huffman.first_symbol[length] + index];
+        }
+    }
+    return -1;
+}
+
+bool png_inflate_fixed_tables(PngRowDecoder& png) {
+    uint8_t lengths[288 + 32];
+    memset(lengths, 8, 144);
+    memset(lengths + 144, 9, 112);
+    memset(lengths + 256, 7, 24);
+    memset(lengths + 280, 8, 8);
+    memset(lengths + 288, 5, 32);
+    return inflate_huffman_build(png.inflate.literals, lengths, 288) &&
+           inflate_huffman_build(png.inflate.distances, lengths + 288, 32);
+}
+
+bool png_inflate_dynamic_tables(PngRowDecoder& png) {
+    static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                      11, 4,  12, 3, 13, 2, 14, 1, 15};
+    int literal_count = png_inflate_bits(png, 5);
+    int distance_count = png_inflate_bits(png, 5);
+    int code_length_count = png_inflate_bits(png, 4);
+    if (literal_count < 0 || distance_count < 0 || code_length_count < 0) return false;
+    literal_count += 257;
+    distance_count += 1;
+    code_length_count += 4;
+
+    uint8_t code_lengths[19] = {};
+    for (int i = 0; i < code_length_count; i++) {
+        int length = png_inflate_bits(png, 3);
+        if (length < 0) return false;
+        code_lengths[order[i]] = uint8_t(length);
+    }
+    InflateHuffman code_length_huffman;
+    if (!inflate_huffman_build(code_length_huffman, code_lengths, 19)) return false;
+
+    uint8_t lengths[288 + 32];
+    int total = literal_count + distance_count;
+    for (int n = 0; n < total;) {
+        int symbol = png_inflate_decode(png, code_length_huffman);
+        if (symbol < 0) return false;
+        if (symbol < 16) {
+            lengths[n++] = uint8_t(symbol);
+            continue;
+        }
+        int value = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (n == 0) return false;
+            value = lengths[n - 1];
+            repeat = png_inflate_bits(png, 2) + 3;
+        } else if (symbol == 17) {
+            repeat = png_inflate_bits(png, 3) + 3;
+        } else {
+            repeat = png_inflate_bits(png, 7) + 11;
+        }
+        if (repeat < 3 || n + repeat > total) return false;
+        memset(lengths + n, value, repeat);
+        n += repeat;
+    }
+    if (lengths[256] == 0) return false;
+    return inflate_huffman_build(png.inflate.literals, lengths, literal_count) &&
+           inflate_huffman_build(png.inflate.distances, lengths + literal_count, distance_count);
+}
+
+// Inflates exactly count more bytes of the image data.
+bool png_inflate_read(PngRowDecoder& png, uint8_t* out, size_t count) {
+    static const uint16_t length_base[29] = {3,  4,  5,  6,  7,  8,  9,   10,  11,  13,
+                                             15, 17, 19, 23, 27, 31, 35,  43,  51,  59,
+                                             67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const uint16_t distance_base[30] = {
+        1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+        193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const uint8_t distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                               6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    Inflate& z = png.inflate;
+    uint8_t* window = z.window.data();
+    const uint64_t mask = INFLATE_WINDOW_SIZE - 1;
+
+    for (size_t i = 0; i < count;) {
+        if (z.copy_length > 0) {
+            uint8_t byte = window[(z.position - z.copy_distance) & mask];
+            window[z.position++ & mask] = byte;
+            out[i++] = byte;
+            z.copy_length--;
+            continue;
+        }
+
+        if (z.block_type < 0) {
+            // The stream ended before the last row.
+            if (z.final_block) return false;
+            int header = png_inflate_bits(png, 3);
+            if (header < 0) return false;
+            z.final_block = header & 1;
+            z.block_type = header >> 1;
+            if (z.block_type == 0) {
+                // Stored blocks start on a byte boundary.
+                z.bits >>= z.bit_count & 7;
+                z.bit_count -= z.bit_count & 7;
+                int length = png_inflate_bits(png, 16);
+                int inverse = png_inflate_bits(png, 16);
+                if (length < 0 || inverse < 0 || (length ^ 0xffff) != inverse) return false;
+                z.stored_remaining = uint32_t(length);
+            } else if (z.block_type == 1) {
+                if (!png_inflate_fixed_tables(png)) return false;
+            } else if (z.block_type != 2 || !png_inflate_dynamic_tables(png)) {
+                return false;
+            }
+            continue;
+        }
+
+        if (z.block_type == 0) {
+            if (z.stored_remaining == 0) {
+                z.block_type = -1;
+                continue;
+            }
+            int byte = png_inflate_bits(png, 8);
+            if (byte < 0) return false;
+            window[z.position++ & mask] = uint8_t(byte);
+            out[i++] = uint8_t(byte);
+            z.stored_remaining--;
+            continue;
+        }
+
+        int symbol = png_inflate_decode(png, z.literals);
+        if (symbol < 0) return false;
+        if (symbol < 256) {
+            window[z.position++ & mask] = uint8_t(symbol);
+            out[i++] = uint8_t(symbol);
+        } else if (symbol == 256) {
+            z.block_type = -1;
+        } else {
+            symbol -= 257;
+            if (symbol >= 29) return false;
+            int extra = png_inflate_bits(png, length_extra[symbol]);
+            int distance = png_inflate_decode(png, z.distances);
+            if (extra < 0 || distance < 0 || distance >= 30) return false;
+            int distance_bits = png_inflate_bits(png, distance_extra[distance]);
+            if (distance_bits < 0) return false;
+            z.copy_length = length_base[symbol] + extra;
+            z.copy_distance = distance_base[distance] + distance_bits;
+            if (uint64_t(z.copy_distance) > z.position) return false;
+        }
+    }
+    return true;
+}
+
+// Reads the chunks up to the first IDAT. False for anything but a non-interlaced PNG.
+bool png_rows_open(PngRowDecoder& png, FILE* file) {
+    static const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    png = PngRowDecoder{};
+    byte_source_open_file(png.source, file);
+    for (int i = 0; i < 256; i++) {
+        png.palette[i][0] = png.palette[i][1] = png.palette[i][2] = 0;
+        png.palette[i][3] = 255;
+    }
+
+    uint8_t header[8];
+    if (!byte_source_read(png.source, header, 8) || memcmp(header, signature, 8) != 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    for (;;) {
+        if (!byte_source_read(png.source, header, 8)) return false;
+        uint32_t length = row_decoders_be32(header);
+        const char* type = (const char*)header + 4;
+        if (memcmp(type, "IDAT", 4) == 0) {
+            png.idat_remaining = length;
+            break;
+        }
+        // Apple's byte swapped variant, and an image without pixels.
+        if (memcmp(type, "CgBI", 4) == 0 || memcmp(type, "IEND", 4) == 0) return false;
+
+        bool wanted = memcmp(type, "IHDR", 4) == 0 || memcmp(type, "PLTE", 4) == 0 ||
+                      memcmp(type, "tRNS", 4) == 0;
+        if (!wanted) {
+            if (!byte_source_skip(png.source, size_t(length) + 4)) return false;
+            continue;
+        }
+        if (length > 1024) return false;
+        data.resize(length);
+        if (!byte_source_read(png.source, data.data(), length) ||
+            !byte_source_skip(png.source, 4)) {
+            return false;
+        }
+
+        if (memcmp(type, "IHDR", 4) == 0) {
+            if (length != 13) return false;
+            uint32_t width = row_decoders_be32(&data[0]);
+            uint32_t height = row_decoders_be32(&data[4]);
+            // Compression, filter method and interlacing.
+            if (width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX ||
+                data[10] != 0 || data[11] != 0 || data[12] != 0) {
+                return false;
+            }
+            png.width = int(width);
+            png.height = int(height);
+            png.depth = data[8];
+            png.color_type = data[9];
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length > 768) return false;
+            for (uint32_t i = 0; i < length / 3; i++) memcpy(png.palette[i], &data[i * 3], 3);
+        } else if (png.color_type == 3) {
+            if (length > 256) return false;
+            for (uint32_t i = 0; i < length; i++) png.palette[i][3] = data[i];
+        } else if (png.color_type == 0 || png.color_type == 2) {
+            int samples = png.color_type == 0 ? 1 : 3;
+            if (length != uint32_t(samples) * 2) return false;
+            for (int i = 0; i < samples; i++) {
+                png.transparent[i] = uint16_t(row_decoders_be16(&data[i * 2]));
+            }
+            png.has_transparency = true;
+        }
+    }
+
+    int depth = png.depth;
+    switch (png.color_type) {
+        case 0:
+            png.channels = 1;
+            if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) return false;
+            break;
+        case 3:
+            png.channels = 1;
+            if (depth != 1 && depth != 2 && depth != 4 && depth != 8) return false;
+            break;
+        case 2:
+        case 4:
+        case 6:
+            png.channels = png.color_type == 2 ? 3 : png.color_type == 4 ? 2 : 4;
+            if (depth != 8 && depth != 16) return false;
+            break;
+        default:
+            return false;
+    }
+    if (png.width == 0) return false;
+    png.filter_stride = std::max(1, png.channels * depth / 8);
+    size_t row_bytes = (size_t(png.width) * png.channels * depth + 7) / 8;
+    png.row.resize(row_bytes);
+    png.previous_row.assign(row_bytes, 0);
+    png.inflate.window.resize(INFLATE_WINDOW_SIZE);
+
+    // zlib header: deflate, no preset dictionary.
+    int cmf = png_rows_idat_byte(png);
+    int flags = png_rows_idat_byte(png);
+    return cmf >= 0 && flags >= 0 && (cmf & 15) == 8 && (cmf << 8 | flags) % 31 == 0 &&
+           !(flags & 32);
+}
+
+int png_rows_sample(const uint8_t* row, size_t index, int depth) {
+    if (depth == 8) return row[index];
+    if (depth == 16) return row[index * 2] << 8 | row[index * 2 + 1];
+    size_t bit = index * depth;
+    return (row[bit / 8] >> (8 - depth - bit % 8)) & ((1 << depth) - 1);
+}
+
+void png_rows_unfilter(PngRowDecoder& png, int filter) {
+    uint8_t* row = png.row.data();
+    const uint8_t* up = png.previous_row.data();
+    size_t size = png.row.size();
+    size_t stride = size_t(png.filter_stride);
+
+    for (size_t i = 0; i < size; i++) {
+        int left = i >= stride ? row[i - stride] : 0;
+        int up_left = i >= stride ? up[i - stride] : 0;
+        switch (filter) {
+            case 1:
+                row[i] += uint8_t(left);
+                break;
+            case 2:
+                row[i] += up[i];
+                break;
+            case 3:
+                row[i] += uint8_t((left + up[i]) >> 1);
+                break;
+            case 4: {
+                int p = left + up[i] - up_left;
+                int pa = abs(p - left);
+                int pb = abs(p - up[i]);
+                int pc = abs(p - up_left);
+                row[i] += uint8_t(pa <= pb && pa <= pc ? left : pb <= pc ? up[i] : up_left);
+                break;
+            }
+        }
+    }
+}
+
+bool png_rows_read(PngRowDecoder& png, uint8_t* out) {
+    if (png.next_row >= png.height) return false;
+    uint8_t filter;
+    if (!png_inflate_read(png, &filter, 1) || filter > 4 ||
+        !png_inflate_read(png, png.row.data(), png.row.size())) {
+        return false;
+    }
+    png_rows_unfilter(png, filter);
+
+    const uint8_t* row = png.row.data();
+    int depth = png.depth;
+    // Gray below 8 bits is stretched to the full range, palette indices are not.
+    int scale = depth < 8 ? 255 / ((1 << depth) - 1) : 1;
+    for (int x = 0; x < png.width; x++) {
+        uint8_t* pixel = out + size_t(x) * 4;
+        if (png.color_type == 3) {
+            memcpy(pixel, png.palette[png_rows_sample(row, size_t(x), depth)], 4);
+            continue;
+        }
+
+        int samples[4];
+        size_t first = size_t(x) * png.channels;
+        for (int c = 0; c < png.channels; c++) {
+            samples[c] = png_rows_sample(row, first + c, depth);
+        }
+        bool transparent = false;
+        if (png.has_transparency) {
+            transparent = png.color_type == 0 ? samples[0] == png.transparent[0]
+                                              : samples[0] == png.transparent[0] &&
+                                                    samples[1] == png.transparent[1] &&
+                                                    samples[2] == png.transparent[2];
+        }
+        for (int c = 0; c < png.channels; c++) {
+            samples[c] = depth == 16 ? samples[c] >> 8 : samples[c] * scale;
+        }
+
+        bool gray = png.channels < 3;
+        pixel[0] = uint8_t(samples[0]);
+        pixel[1] = uint8_t(samples[gray ? 0 : 1]);
+        pixel[2] = uint8_t(samples[gray ? 0 : 2]);
+        pixel[3] = png.channels == 2 ? uint8_t(samples[1])
+                   : png.channels == 4 ? uint8_t(samples[3])
+                                       : 255;
+        if (transparent) pixel[3] = 0;
+    }
+
+    std::swap(png.row, png.previous_row);
+    png.next_row++;
+    return true;
+}
+
+// JPEG
+
+#define JPEG_FAST_BITS 9
+
+// Huffman table of a JPEG, codes up to JPEG_FAST_BITS long are looked up directly.
+struct JpegHuffman {
+    // (length << 8) | symbol, 0 where the code is longer.
+    uint16_t fast[1 << JPEG_FAST_BITS];
+    // Per length, the first 16 bit left aligned code that is longer.
+    uint32_t max_code[18];
+    int delta[17];
+    uint8_t symbols[256];
+    int count;
+};
+
+struct JpegComponent {
+    int id = 0;
+    int h = 1;
+    int v = 1;
+    int quant = 0;
+    int dc_table = 0;
+    int ac_table = 0;
+    int dc_prediction = 0;
+    // One MCU row of the component's samples.
+    std::vector<uint8_t> plane;
+    int plane_width = 0;
+};
+
+struct JpegRowDecoder {
+    ByteSource source;
+    // Of the rows handed out.
+    int width = 0;
+    int height = 0;
+    int source_width = 0;
+    int source_height = 0;
+    // Pixels a side each 8x8 block of coefficients is decoded to.
+    int block_size = 8;
+    int component_count = 0;
+    JpegComponent components[3];
+    // Components in the order the scan interleaves them.
+    int scan_components[3] = {};
+    bool rgb = false;
+    bool jfif = false;
+    int adobe_transform = -1;
+    uint16_t quant[4][64];
+    bool quant_defined[4] = {};
+    JpegHuffman dc_tables[4];
+    JpegHuffman ac_tables[4];
+    bool dc_defined[4] = {};
+    bool ac_defined[4] = {};
+    int max_h = 1;
+    int max_v = 1;
+    int mcus_x = 0;
+    int mcus_y = 0;
+    int restart_interval = 0;
+    int mcus_to_restart = 0;
+    // Entropy coded data, most significant bit first. A marker ends it, zeros are read after.
+    uint32_t bits = 0;
+    int bit_count = 0;
+    int marker = -1;
+    // idct[x][u], the basis of the inverse DCT at block_size points.
+    float idct[8][8];
+    int mcu_row = 0;
+    int band_row = 0;
+    int next_row = 0;
+};
+
+static const uint8_t jpeg_dezigzag[64] = {
+    0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+    41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+    30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+bool jpeg_huffman_build(JpegHuffman& huffman, const uint8_t* counts, const uint8_t* symbols) {
+    memset(&huffman, 0, sizeof(huffman));
+    uint8_t lengths[256];
+    uint16_t codes[256];
+    int k = 0;
+    uint32_t code = 0;
+    for (int length = 1; length <= 16; length++) {
+        huffman.delta[length] = k - int(code);
+        for (int i = 0; i < counts[length - 1]; i++) {
+            lengths[k] = uint8_t(length);
+            codes[k++] = uint16_t(code++);
+        }
+        if (code > (1u << length)) return false;
+        huffman.max_code[length] = code << (16 - length);
+        code <<= 1;
+    }
+    huffman.max_code[17] = UINT32_MAX;
+    huffman.count = k;
+    memcpy(huffman.symbols, symbols, k);
+
+    for (int i = 0; i < k; i++) {
+        int length = lengths[i];
+        if (length > JPEG_FAST_BITS) continue;
+        int first = codes[i] << (JPEG_FAST_BITS - length);
+        for (int j = 0; j < 1 << (JPEG_FAST_BITS - length); j++) {
+            huffman.fast[first + j] = uint16_t(length << 8 | symbols[i]);
+        }
+    }
+    return true;
+}
+
+void jpeg_rows_fill(JpegRowDecoder& jpeg) {
+    while (jpeg.bit_count <= 24) {
+        int byte = 0;
+        if (jpeg.marker < 0) {
+            byte = byte_source_get(jpeg.source);
+            if (byte == 0xFF) {
+                int next = byte_source_get(jpeg.source);
+                while (next == 0xFF) next = byte_source_get(jpeg.source);
+                // FF 00 is a stuffed FF, anything else a marker. A truncated file ends like EOI.
+                if (next != 0) {
+                    jpeg.marker = next < 0 ? 0xD9 : next;
+                    byte = 0;
+                }
+            } else if (byte < 0) {
+                jpeg.marker = 0xD9;
+                byte = 0;
+            }
+        }
+        jpeg.bits |= uint32_t(byte) << (24 - jpeg.bit_count);
+        jpeg.bit_count += 8;
+    }
+}
+
+int jpeg_rows_decode(JpegRowDecoder& jpeg, const JpegHuffman& huffman) {
+    if (jpeg.bit_count < 16) jpeg_rows_fill(jpeg);
+    uint16_t entry = huffman.fast[jpeg.bits >> (32 - JPEG_FAST_BITS)];
+    if (entry) {
+        int length = entry >> 8;
+        jpeg.bits <<= length;
+        jpeg.bit_count -= length;
+        return entry & 255;
+    }
+
+    uint32_t code = jpeg.bits >> 16;
+    int length = JPEG_FAST_BITS + 1;
+    while (code >= huffman.max_code[length]) length++;
+    if (length > 16) return -1;
+    int index = int(code >> (16 - length)) + huffman.delta[length];
+    if (index < 0 || index >= huffman.count) return -1;
+    jpeg.bits <<= length;
+    jpeg.bit_count -= length;
+    return huffman.symbols[index];
+}
+
+// Reads a size bit magnitude and sign extends it the JPEG way.
+int jpeg_rows_receive(JpegRowDecoder& jpeg, int size) {
+    if (size == 0) return 0;
+    if (jpeg.bit_count < size) jpeg_rows_fill(jpeg);
+    int value = int(jpeg.bits >> (32 - size));
+    jpeg.bits <<= size;
+    jpeg.bit_count -= size;
+    return value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+}
+
+// Dequantized coefficients of the next block in natural order, returns how many of them past
+// the DC are not zero, -1 on corrupt data.
+int jpeg_rows_decode_block(JpegRowDecoder& jpeg, JpegComponent& component, float* coefficients) {
+    const uint16_t* quant = jpeg.quant[component.quant];
+    memset(coefficients, 0, 64 * sizeof(float));
+    int size = jpeg_rows_decode(jpeg, jpeg.dc_tables[component.dc_table]);
+    if (size < 0 || size > 11) return -1;
+    component.dc_prediction += jpeg_rows_receive(jpeg, size);
+    coefficients[0] = float(component.dc_prediction * quant[0]);
+
+    int ac_count = 0;
+    for (int k = 1; k < 64;) {
+        int run_size = jpeg_rows_decode(jpeg, jpeg.ac_tables[component.ac_table]);
+        if (run_size < 0) return -1;
+        int run = run_size >> 4;
+        size = run_size & 15;
+        if (size == 0) {
+            if (run != 15) break;
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63) return -1;
+        coefficients[jpeg_dezigzag[k]] = float(jpeg_rows_receive(jpeg, size) * quant[k]);
+        ac_count++;
+        k++;
+    }
+    return ac_count;
+}
+
+// Separable inverse DCT of the block_size lowest frequencies into block_size pixels a side. Below
+// 8 that is the block scaled down, each pixel sampled at the centre of the ones it covers.
+void jpeg_rows_idct(const JpegRowDecoder& jpeg, const float* coefficients, int ac_count,
+                    uint8_t* out, int stride) {
+    int n = jpeg.block_size;
+    if (ac_count == 0) {
+        uint8_t value = row_decoders_clamp(coefficients[0] * jpeg.idct[0][0] * jpeg.idct[0][0] +
+                                           128.5f);
+        for (int y = 0; y < n; y++) memset(out + y * stride, value, n);
+        return;
+    }
+
+    float rows[8][8];
+    for (int v = 0; v < n; v++) {
+        for (int x = 0; x < n; x++) {
+            float sum = 0.0f;
+            for (int u = 0; u < n; u++) sum += jpeg.idct[x][u] * coefficients[v * 8 + u];
+            rows[v][x] = sum;
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            float sum = 128.5f;
+            for (int v = 0; v < n; v++) sum += jpeg.idct[y][v] * rows[v][x];
+            out[y * stride + x] = row_decoders_clamp(sum);
+        }
+    }
+}
+
+bool jpeg_rows_frame(JpegRowDecoder& jpeg, const std::vector<uint8_t>& segment) {
+    // 8 bit samples only, 12 bit ones go to stb_image.
+    if (segment.size() < 6 || segment[0] != 8) return false;
+    jpeg.source_height = row_decoders_be16(&segment[1]);
+    jpeg.source_width = row_decoders_be16(&segment[3]);
+    jpeg.component_count = segment[5];
+    // Without a height up front it would come in a DNL marker after the scan.
+    if (jpeg.source_width == 0 || jpeg.source_height == 0) return false;
+    if (jpeg.component_count != 1 && jpeg.component_count != 3) return false;
+    if (segment.size() < 6 + 3 * size_t(jpeg.component_count)) return false;
+
+    for (int i = 0; i < jpeg.component_count; i++) {
+        JpegComponent& component = jpeg.components[i];
+        const uint8_t* spec = &segment[6 + 3 * i];
+        component.id = spec[0];
+        component.h = spec[1] >> 4;
+        component.v = spec[1] & 15;
+        component.quant = spec[2];
+        if (component.h < 1 || component.h > 4 || component.v < 1 || component.v > 4 ||
+            component.quant > 3) {
+            return false;
+        }
+        jpeg.max_h = std::max(jpeg.max_h, component.h);
+        jpeg.max_v = std::max(jpeg.max_v, component.v);
+    }
+    for (int i = 0; i < jpeg.component_count; i++) {
+        if (jpeg.max_h % jpeg.components[i].h || jpeg.max_v % jpeg.components[i].v) return false;
+    }
+    // A single component scan isn't interleaved, its MCU is one block whatever the sampling.
+    if (jpeg.component_count == 1) {
+        jpeg.components[0].h = jpeg.components[0].v = jpeg.max_h = jpeg.max_v = 1;
+    }
+    return true;
+}
+
+bool jpeg_rows_scan(JpegRowDecoder& jpeg, const std::vector<uint8_t>& segment) {
+    // All components in one sequential scan, the only layout that can be decoded in one pass.
+    if (segment.empty() || segment[0] != jpeg.component_count) return false;
+    size_t count = segment[0];
+    if (segment.size() < 1 + 2 * count + 3) return false;
+
+    for (size_t i = 0; i < count; i++) {
+        int index = -1;
+        for (int c = 0; c < jpeg.component_count; c++) {
+            if (jpeg.components[c].id == segment[1 + 2 * i]) index = c;
+        }
+        if (index < 0) return false;
+        JpegComponent& component = jpeg.components[index];
+        component.dc_table = segment[2 + 2 * i] >> 4;
+        component.ac_table = segment[2 + 2 * i] & 15;
+        if (component.dc_table > 3 || component.ac_table > 3 ||
+            !jpeg.dc_defined[component.dc_table] || !jpeg.ac_defined[component.ac_table] ||
+            !jpeg.quant_defined[component.quant]) {
+            return false;
+        }
+        jpeg.scan_components[i] = index;
+    }
+    const uint8_t* spectral = &segment[1 + 2 * count];
+    if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0) return false;
+
+    const JpegComponent* components = jpeg.components;
+    jpeg.rgb = jpeg.component_count == 3 &&
+               ((components[0].id == 'R' && components[1].id == 'G' && components[2].id == 'B') ||
+                (jpeg.adobe_transform == 0 && !jpeg.jfif));
+    return true;
+}
+
+bool jpeg_rows_tables(JpegRowDecoder& jpeg, int marker, const std::vector<uint8_t>& segment) {
+    size_t size = segment.size();
+    for (size_t p = 0; p < size;) {
+        int kind = segment[p] >> 4;
+        int index = segment[p] & 15;
+        if (marker == 0xC4) {
+            if (kind > 1 || index > 3 || p + 17 > size) return false;
+            const uint8_t* counts = &segment[p + 1];
+            size_t total = 0;
+            for (int i = 0; i < 16; i++) total += counts[i];
+            if (total > 256 || p + 17 + total > size) return false;
+            JpegHuffman& huffman = kind == 0 ? jpeg.dc_tables[index] : jpeg.ac_tables[index];
+            if (!jpeg_huffman_build(huffman, counts, &segment[p + 17])) return false;
+            (kind == 0 ? jpeg.dc_defined : jpeg.ac_defined)[index] = true;
+            p += 17 + total;
+        } else {
+            // 16 bit quantization tables are allowed with 8 bit samples too.
+            size_t bytes = kind ? 128 : 64;
+            if (kind > 1 || index > 3 || p + 1 + bytes > size) return false;
+            for (int k = 0; k < 64; k++) {
+                jpeg.quant[index][k] = uint16_t(kind ? row_decoders_be16(&segment[p + 1 + k * 2])
+                                                     : segment[p + 1 + k]);
+            }
+            jpeg.quant_defined[index] = true;
+            p += 1 + bytes;
+        }
+    }
+    return true;
+}
+
+// Reads the markers up to the scan. False for anything but a single scan baseline JPEG.
+bool jpeg_rows_start(JpegRowDecoder& jpeg) {
+    if (byte_source_get(jpeg.source) != 0xFF || byte_source_get(jpeg.source) != 0xD8) return false;
+
+    std::vector<uint8_t> segment;
+    bool has_frame = false;
+    for (;;) {
+        int byte = byte_source_get(jpeg.source);
+        if (byte != 0xFF) return false;
+        int marker = byte_source_get(jpeg.source);
+        while (marker == 0xFF) marker = byte_source_get(jpeg.source);
+        if (marker < 0 || marker == 0xD9) return false;
+        // Markers without a segment.
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) continue;
+
+        uint8_t length_bytes[2];
+        if (!byte_source_read(jpeg.source, length_bytes, 2)) return false;
+        int length = row_decoders_be16(length_bytes) - 2;
+        if (length < 0) return false;
+        segment.resize(length);
+        if (!byte_source_read(jpeg.source, segment.data(), length)) return false;
+
+        if (marker == 0xC0 || marker == 0xC1) {
+            if (has_frame || !jpeg_rows_frame(jpeg, segment)) return false;
+            has_frame = true;
+        } else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xCC) {
+            // Progressive, lossless and arithmetic coded frames.
+            return false;
+        } else if (marker == 0xC4 || marker == 0xDB) {
+            if (!jpeg_rows_tables(jpeg, marker, segment)) return false;
+        } else if (marker == 0xDD) {
+            if (length < 2) return false;
+            jpeg.restart_interval = row_decoders_be16(segment.data());
+        } else if (marker == 0xE0 && length >= 5 && memcmp(segment.data(), "JFIF", 5) == 0) {
+            jpeg.jfif = true;
+        } else if (marker == 0xEE && length >= 12 && memcmp(segment.data(), "Adobe", 5) == 0) {
+            jpeg.adobe_transform = segment[11];
+        } else if (marker == 0xDA) {
+            if (!has_frame || !jpeg_rows_scan(jpeg, segment)) return false;
+            break;
+        }
+    }
+
+    int n = jpeg.block_size;
+    jpeg.width = (jpeg.source_width * n + 7) / 8;
+    jpeg.height = (jpeg.source_height * n + 7) / 8;
+    jpeg.mcus_x = (jpeg.source_width + 8 * jpeg.max_h - 1) / (8 * jpeg.max_h);
+    jpeg.mcus_y = (jpeg.source_height + 8 * jpeg.max_v - 1) / (8 * jpeg.max_v);
+    for (int i = 0; i < jpeg.component_count; i++) {
+        JpegComponent& component = jpeg.components[i];
+        component.plane_width = jpeg.mcus_x * component.h * n;
+        component.plane.resize(size_t(component.plane_width) * component.v * n);
+    }
+    for (int x = 0; x < n; x++) {
+        for (int u = 0; u < n; u++) {
+            float c = u == 0 ? 1.0f / sqrtf(2.0f) : 1.0f;
+            jpeg.idct[x][u] = c / 2.0f * cosf(float((2 * x + 1) * u) * 3.14159265f / float(2 * n));
+        }
+    }
+    jpeg.mcus_to_restart = jpeg.restart_interval;
+    // The first read decodes the first MCU row.
+    jpeg.band_row = jpeg.max_v * n;
+    return true;
+}
+
+// scale_denominator is 1, 2, 4 or 8, the rows handed out are that many times smaller.
+bool jpeg_rows_open_file(JpegRowDecoder& jpeg, FILE* file, int scale_denominator = 1) {
+    jpeg = JpegRowDecoder{};
+    jpeg.block_size = 8 / scale_denominator;
+    byte_source_open_file(jpeg.source, file);
+    return jpeg_rows_start(jpeg);
+}
+
+bool jpeg_rows_open_memory(JpegRowDecoder& jpeg, const uint8_t* data, size_t size,
+                           int scale_denominator = 1) {
+    jpeg = JpegRowDecoder{};
+    jpeg.block_size = 8 / scale_denominator;
+    byte_source_open_memory(jpeg.source, data, size);
+    return jpeg_rows_start(jpeg);
+}
+
+bool jpeg_rows_restart(JpegRowDecoder& jpeg) {
+    jpeg.bits = 0;
+    jpeg.bit_count = 0;
+    // The bit reader stops at the marker, unless the interval ended exactly on a byte before it.
+    while (jpeg.marker < 0) {
+        int byte = byte_source_get(jpeg.source);
+        if (byte < 0) return false;
+        if (byte != 0xFF) continue;
+        int next = byte_source_get(jpeg.source);
+        while (next == 0xFF) next = byte_source_get(jpeg.source);
+        if (next < 0) return false;
+        if (next != 0) jpeg.marker = next;
+    }
+    if (jpeg.marker < 0xD0 || jpeg.marker > 0xD7) return false;
+    jpeg.marker = -1;
+    for (int i = 0; i < jpeg.component_count; i++) jpeg.components[i].dc_prediction = 0;
+    jpeg.mcus_to_restart = jpeg.restart_interval;
+    return true;
+}
+
+bool jpeg_rows_decode_mcu_row(JpegRowDecoder& jpeg) {
+    if (jpeg.mcu_row >= jpeg.mcus_y) return false;
+    int n = jpeg.block_size;
+    float coefficients[64];
+    for (int mx = 0; mx < jpeg.mcus_x; mx++) {
+        if (jpeg.restart_interval) {
+            if (jpeg.mcus_to_restart == 0 && !jpeg_rows_restart(jpeg)) return false;
+            jpeg.mcus_to_restart--;
+        }
+        for (int i = 0; i < jpeg.component_count; i++) {
+            JpegComponent& component = jpeg.components[jpeg.scan_components[i]];
+            for (int by = 0; by < component.v; by++) {
+                for (int bx = 0; bx < component.h; bx++) {
+                    int ac_count = jpeg_rows_decode_block(jpeg, component, coefficients);
+                    if (ac_count < 0) return false;
+                    uint8_t* out = component.plane.data() +
+                                   size_t(by * n) * component.plane_width +
+                                   (mx * component.h + bx) * n;
+                    jpeg_rows_idct(jpeg, coefficients, ac_count, out, component.plane_width);
+                }
+            }
+        }
+    }
+    jpeg.mcu_row++;
+    return true;
+}
+
+bool jpeg_rows_read(JpegRowDecoder& jpeg, uint8_t* out) {
+    if (jpeg.next_row >= jpeg.height) return false;
+    if (jpeg.band_row == jpeg.max_v * jpeg.block_size) {
+        if (!jpeg_rows_decode_mcu_row(jpeg)) return false;
+        jpeg.band_row = 0;
+    }
+    int y = jpeg.band_row++;
+
+    if (jpeg.component_count == 1) {
+        const uint8_t* gray = jpeg.components[0].plane.data() +
+                              size_t(y) * jpeg.components[0].plane_width;
+        for (int x = 0; x < jpeg.width; x++) {
+            out[x * 4 + 0] = out[x * 4 + 1] = out[x * 4 + 2] = gray[x];
+            out[x * 4 + 3] = 255;
+        }
+    } else {
+        // Subsampled chroma is taken from the nearest sample.
+        const uint8_t* rows[3];
+        for (int i = 0; i < 3; i++) {
+            const JpegComponent& component = jpeg.components[i];
+            rows[i] = component.plane.data() +
+                      size_t(y * component.v / jpeg.max_v) * component.plane_width;
+        }
+        int h0 = jpeg.components[0].h;
+        int h1 = jpeg.components[1].h;
+        int h2 = jpeg.components[2].h;
+        for (int x = 0; x < jpeg.width; x++) {
+            int a = rows[0][x * h0 / jpeg.max_h];
+            int b = rows[1][x * h1 / jpeg.max_h];
+            int c = rows[2][x * h2 / jpeg.max_h];
+            uint8_t* pixel = out + size_t(x) * 4;
+            if (jpeg.rgb) {
+                pixel[0] = uint8_t(a);
+                pixel[1] = uint8_t(b);
+                pixel[2] = uint8_t(c);
+            } else {
+                float luma = float(a) + 0.5f;
+                float cb = float(b - 128);
+                float cr = float(c - 128);
+                pixel[0] = row_decoders_clamp(luma + 1.402f * cr);
+                pixel[1] = row_decoders_clamp(luma - 0.344136f * cb - 0.714136f * cr);
+                pixel[2] = row_decoders_clamp(luma + 1.772f * cb);
+            }
+            pixel[3] = 255;
+        }
+    }
+    jpeg.next_row++;
+    return true;
+}
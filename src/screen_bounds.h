@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SCREEN_BOUNDS_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCREEN_BOUNDS_LANES 4
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define SCREEN_BOUNDS_LANES 4
+#else
+#define SCREEN_BOUNDS_LANES 1
+#endif
+
+// Axis-aligned rectangles as separate coordinate arrays, so a kernel can load several rectangles'
+// worth of one coordinate at a time.
+struct BoundsSoA {
+    std::vector<float> min_x;
+    std::vector<float> min_y;
+    std::vector<float> max_x;
+    std::vector<float> max_y;
+};
+
+void bounds_soa_clear(BoundsSoA& bounds) {
+    bounds.min_x.clear();
+    bounds.min_y.clear();
+    bounds.max_x.clear();
+    bounds.max_y.clear();
+}
+
+void bounds_soa_push(BoundsSoA& bounds, glm::vec2 min, glm::vec2 max) {
+    bounds.min_x.push_back(min.x);
+    bounds.min_y.push_back(min.y);
+    bounds.max_x.push_back(max.x);
+    bounds.max_y.push_back(max.y);
+}
+
+uint32_t bounds_soa_size(const BoundsSoA& bounds) {
+    return uint32_t(bounds.min_x.size());
+}
+
+// World to screen pixels as a scale and offset per axis, screen y going down. Only holds for a
+// camera without rotation or perspective, which is all the board has.
+struct ScreenTransform {
+    glm::vec2 scale;
+    glm::vec2 offset;
+};
+
+ScreenTransform screen_transform(const glm::mat4& view_proj, int width, int height) {
+    glm::vec2 half_size = glm::vec2(float(width), float(height)) * 0.5f;
+    return ScreenTransform{
+        .scale = glm::vec2(view_proj[0][0] * half_size.x, -view_proj[1][1] * half_size.y),
+        .offset = glm::vec2((view_proj[3][0] + 1.0f) * half_size.x,
+                            float(height) - (view_proj[3][1] + 1.0f) * half_size.y)};
+}
+
+// Maps one axis of rectangles [begin, end) and orders each mapped pair into min and max, the
+// scale may be negative.
+void screen_bounds_project_axis_scalar(const float* lo, const float* hi, float scale, float offset,
+                                       float* out_lo, float* out_hi, uint32_t begin,
+                                       uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+        float a = lo[i] * scale + offset;
+        float b = hi[i] * scale + offset;
+        out_lo[i] = a < b ? a : b;
+        out_hi[i] = a < b ? b : a;
+    }
+}
+
+void screen_bounds_project_axis(const float* lo, const float* hi, float scale, float offset,
+                                float* out_lo, float* out_hi, uint32_t count) {
+    uint32_t i = 0;
+#if defined(__AVX2__)
+    __m256 scale_v = _mm256_set1_ps(scale);
+    __m256 offset_v = _mm256_set1_ps(offset);
+    for (; i + 8 <= count; i += 8) {
+        __m256 a = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(lo + i), scale_v), offset_v);
+        __m256 b = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(hi + i), scale_v), offset_v);
+        _mm256_storeu_ps(out_lo + i, _mm256_min_ps(a, b));
+        _mm256_storeu_ps(out_hi + i, _mm256_max_ps(a, b));
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    __m128 scale_v = _mm_set1_ps(scale);
+    __m128 offset_v = _mm_set1_ps(offset);
+    for (; i + 4 <= count; i += 4) {
+        __m128 a = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(lo + i), scale_v), offset_v);
+        __m128 b = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(hi + i), scale_v), offset_v);
+        _mm_storeu_ps(out_lo + i, _mm_min_ps(a, b));
+        _mm_storeu_ps(out_hi + i, _mm_max_ps(a, b));
+    }
+#elif defined(__wasm_simd128__)
+    v128_t scale_v = wasm_f32x4_splat(scale);
+    v128_t offset_v = wasm_f32x4_splat(offset);
+    for (; i + 4 <= count; i += 4) {
+        v128_t a = wasm_f32x4_add(wasm_f32x4_mul(wasm_v128_load(lo + i), scale_v), offset_v);
+        v128_t b = wasm_f32x4_add(wasm_f32x4_mul(wasm_v128_load(hi + i), scale_v), offset_v);
+        wasm_v128_store(out_lo + i, wasm_f32x4_pmin(a, b));
+        wasm_v128_store(out_hi + i, wasm_f32x4_pmax(a, b));
+    }
+#endif
+    screen_bounds_project_axis_scalar(lo, hi, scale, offset, out_lo, out_hi, i, count);
+}
+
+// Projects world-space rectangles to screen pixels in one pass over each axis, SCREEN_BOUNDS_LANES
+// rectangles at a time.
+void screen_bounds_project(const BoundsSoA& world, const ScreenTransform& transform,
+                           BoundsSoA& screen) {
+    uint32_t count = bounds_soa_size(world);
+    screen.min_x.resize(count);
+    screen.min_y.resize(count);
+    screen.max_x.resize(count);
+    screen.max_y.resize(count);
+    screen_bounds_project_axis(world.min_x.data(), world.max_x.data(), transform.scale.x,
+                               transform.offset.x, screen.min_x.data(), screen.max_x.data(),
+                               count);
+    screen_bounds_project_axis(world.min_y.data(), world.max_y.data(), transform.scale.y,
+                               transform.offset.y, screen.min_y.data(), screen.max_y.data(),
+                               count);
+}
+
+// Same result one rectangle at a time, the baseline the benchmark compares against.
+void screen_bounds_project_scalar(const BoundsSoA& world, const ScreenTransform& transform,
+                                  BoundsSoA& screen) {
+    uint32_t count = bounds_soa_size(world);
+    screen.min_x.resize(count);
+    screen.min_y.resize(count);
+    screen.max_x.resize(count);
+    screen.max_y.resize(count);
+    screen_bounds_project_axis_scalar(world.min_x.data(), world.max_x.data(), transform.scale.x,
+                                      transform.offset.x, screen.min_x.data(),
+                                      screen.max_x.data(), 0, count);
+    screen_bounds_project_axis_scalar(world.min_y.data(), world.max_y.data(), transform.scale.y,
+                                      transform.offset.y, screen.min_y.data(),
+                                      screen.max_y.data(), 0, count);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+// Reference to a slot that stays valid while the slot's contents move around, and turns stale
+// once the slot is freed, even if the slot is handed out again afterwards.
+struct Handle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+bool operator==(Handle a, Handle b) {
+    return a.index == b.index && a.generation == b.generation;
+}
+
+bool operator!=(Handle a, Handle b) {
+    return !(a == b);
+}
+
+// Hands out slot indices and checks handles against them. The data itself lives in arrays owned by
+// the user, indexed by Handle::index and grown to slot_map_capacity after an insert.
+struct SlotMap {
+    std::vector<uint32_t> generations;
+    std::vector<uint8_t> alive;
+    std::vector<uint32_t> free_slots;
+    uint32_t count = 0;
+};
+
+uint32_t slot_map_capacity(const SlotMap& map) {
+    return uint32_t(map.generations.size());
+}
+
+Handle slot_map_insert(SlotMap& map) {
+    uint32_t index;
+    if (!map.free_slots.empty()) {
+        index = map.free_slots.back();
+        map.free_slots.pop_back();
+    } else {
+        index = uint32_t(map.generations.size());
+        map.generations.push_back(0);
+        map.alive.push_back(0);
+    }
+    map.alive[index] = 1;
+    map.count++;
+    return Handle{.index = index, .generation = map.generations[index]};
+}
+
+bool slot_map_contains(const SlotMap& map, Handle handle) {
+    return handle.index < map.generations.size() && map.alive[handle.index] &&
+           map.generations[handle.index] == handle.generation;
+}
+
+// Frees the slot and invalidates every handle to it, returns false for a stale handle.
+bool slot_map_remove(SlotMap& map, Handle handle) {
+    if (!slot_map_contains(map, handle)) return false;
+
+    map.generations[handle.index]++;
+    map.alive[handle.index] = 0;
+    map.free_slots.push_back(handle.index);
+    map.count--;
+    return true;
+}
+
+// Current handle of a live slot, for code that walks the slots by index.
+Handle slot_map_handle(const SlotMap& map, uint32_t index) {
+    return Handle{.index = index, .generation = map.generations[index]};
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#define SPATIAL_INDEX_NONE UINT32_MAX
+// Cells stop splitting at this half size, tiny or empty items don't send the tree arbitrarily deep.
+#define SPATIAL_INDEX_MIN_HALF_SIZE (1.0f / 1024.0f)
+
+// Square cell of the quadtree. Items are kept in the deepest cell at least as large as they are,
+// chosen by their center, so an item may stick out of its cell by up to half the cell size on each
+// side. Queries test against these loose bounds, twice the cell size.
+struct SpatialNode {
+    glm::vec2 center;
+    float half_size;
+    uint32_t parent = SPATIAL_INDEX_NONE;
+    uint32_t children[4] = {SPATIAL_INDEX_NONE, SPATIAL_INDEX_NONE, SPATIAL_INDEX_NONE,
+                            SPATIAL_INDEX_NONE};
+    std::vector<uint32_t> items;
+    // Items in this cell and all cells below it, empty branches are skipped by queries.
+    uint32_t count = 0;
+};
+
+struct SpatialItem {
+    glm::vec2 min;
+    glm::vec2 max;
+    uint32_t node = SPATIAL_INDEX_NONE;
+    uint32_t position = 0;
+};
+
+// Loose quadtree over world-space rectangles, keyed by item id (the quad slot). The root grows
+// outwards to cover wherever items go, so the board has no fixed extent.
+struct SpatialIndex {
+    std::vector<SpatialNode> nodes;
+    std::vector<SpatialItem> items;
+    std::vector<uint32_t> free_nodes;
+    uint32_t root = SPATIAL_INDEX_NONE;
+    std::vector<uint32_t> stack;
+};
+
+uint32_t spatial_index_new_node(SpatialIndex& si, glm::vec2 center, float half_size,
+                                uint32_t parent) {
+    uint32_t index;
+    if (!si.free_nodes.empty()) {
+        index = si.free_nodes.back();
+        si.free_nodes.pop_back();
+    } else {
+        index = uint32_t(si.nodes.size());
+        si.nodes.emplace_back();
+    }
+    SpatialNode& node = si.nodes[index];
+    node = SpatialNode{};
+    node.center = center;
+    node.half_size = half_size;
+    node.parent = parent;
+    return index;
+}
+
+// Detaches a branch that no longer holds any item and recycles its cells.
+void spatial_index_free_branch(SpatialIndex& si, uint32_t branch) {
+    uint32_t parent = si.nodes[branch].parent;
+    for (uint32_t& child : si.nodes[parent].children) {
+        if (child == branch) child = SPATIAL_INDEX_NONE;
+    }
+
+    si.stack.clear();
+    si.stack.push_back(branch);
+    while (!si.stack.empty()) {
+        uint32_t n = si.stack.back();
+        si.stack.pop_back();
+        for (uint32_t child : si.nodes[n].children) {
+            if (child != SPATIAL_INDEX_NONE) si.stack.push_back(child);
+        }
+        si.nodes[n] = SpatialNode{};
+        si.free_nodes.push_back(n);
+    }
+}
+
+int spatial_index_quadrant(const SpatialNode& node, glm::vec2 point) {
+    return (point.x >= node.center.x ? 1 : 0) | (point.y >= node.center.y ? 2 : 0);
+}
+
+bool spatial_index_fits_child(const SpatialNode& node, float extent) {
+    float child_half = node.half_size * 0.5f;
+    return child_half >= SPATIAL_INDEX_MIN_HALF_SIZE && extent <= child_half;
+}
+
+bool spatial_index_node_holds(const SpatialNode& node, glm::vec2 center, float extent) {
+    return extent <= node.half_size && center.x >= node.center.x - node.half_size &&
+           center.x <= node.center.x + node.half_size &&
+           center.y >= node.center.y - node.half_size &&
+           center.y <= node.center.y + node.half_size;
+}
+
+// Doubles the root towards point, the old root becomes one of the new root's quadrants.
+void spatial_index_grow(SpatialIndex& si, glm::vec2 point) {
+    SpatialNode& old_root = si.nodes[si.root];
+    glm::vec2 direction = glm::vec2(point.x >= old_root.center.x ? 1.0f : -1.0f,
+                                    point.y >= old_root.center.y ? 1.0f : -1.0f);
+    glm::vec2 center = old_root.center + direction * old_root.half_size;
+    float half_size = old_root.half_size * 2.0f;
+    uint32_t old_root_index = si.root;
+    uint32_t count = old_root.count;
+
+    si.root = spatial_index_new_node(si, center, half_size, SPATIAL_INDEX_NONE);
+    SpatialNode& root = si.nodes[si.root];
+    root.count = count;
+    root.children[spatial_index_quadrant(root, si.nodes[old_root_index].center)] = old_root_index;
+    si.nodes[old_root_index].parent = si.root;
+}
+
+void spatial_index_remove(SpatialIndex& si, uint32_t id) {
+    if (id >= si.items.size() || si.items[id].node == SPATIAL_INDEX_NONE) return;
+
+    SpatialItem& item = si.items[id];
+    SpatialNode& node = si.nodes[item.node];
+    uint32_t last = node.items.back();
+    node.items[item.position] = last;
+    si.items[last].position = item.position;
+    node.items.pop_back();
+
+    uint32_t empty_branch = SPATIAL_INDEX_NONE;
+    for (uint32_t n = item.node; n != SPATIAL_INDEX_NONE; n = si.nodes[n].parent) {
+        if (--si.nodes[n].count == 0 && n != si.root) empty_branch = n;
+    }
+    item.node = SPATIAL_INDEX_NONE;
+    if (empty_branch != SPATIAL_INDEX_NONE) spatial_index_free_branch(si, empty_branch);
+}
+
+// Adds an item or moves it to new bounds. An item that still belongs to the same cell is only
+// updated in place.
+void spatial_index_update(SpatialIndex& si, uint32_t id, glm::vec2 min, glm::vec2 max) {
+    if (id >= si.items.size()) si.items.resize(id + 1);
+    glm::vec2 center = (min + max) * 0.5f;
+    float extent = glm::max(max.x - min.x, max.y - min.y) * 0.5f;
+
+    SpatialItem& item = si.items[id];
+    if (item.node != SPATIAL_INDEX_NONE) {
+        const SpatialNode& node = si.nodes[item.node];
+        if (spatial_index_node_holds(node, center, extent) &&
+            !spatial_index_fits_child(node, extent)) {
+            item.min = min;
+            item.max = max;
+            return;
+        }
+        spatial_index_remove(si, id);
+    }
+
+    if (si.root == SPATIAL_INDEX_NONE) {
+        float half_size = 1.0f;
+        while (half_size < extent) half_size *= 2.0f;
+        si.root = spatial_index_new_node(si, center, half_size, SPATIAL_INDEX_NONE);
+    }
+    while (!spatial_index_node_holds(si.nodes[si.root], center, extent)) {
+        spatial_index_grow(si, center);
+    }
+
+    uint32_t n = si.root;
+    while (spatial_index_fits_child(si.nodes[n], extent)) {
+        si.nodes[n].count++;
+        int quadrant = spatial_index_quadrant(si.nodes[n], center);
+        uint32_t child = si.nodes[n].children[quadrant];
+        if (child == SPATIAL_INDEX_NONE) {
+            float child_half = si.nodes[n].half_size * 0.5f;
+            glm::vec2 offset = glm::vec2(quadrant & 1 ? child_half : -child_half,
+                                         quadrant & 2 ? child_half : -child_half);
+            child = spatial_index_new_node(si, si.nodes[n].center + offset, child_half, n);
+            si.nodes[n].children[quadrant] = child;
+        }
+        n = child;
+    }
+    SpatialNode& node = si.nodes[n];
+    node.count++;
+
+    SpatialItem& placed = si.items[id];
+    placed.min = min;
+    placed.max = max;
+    placed.node = n;
+    placed.position = uint32_t(node.items.size());
+    node.items.push_back(id);
+}
+
+// Appends the ids of all items whose bounds overlap the rectangle, in no particular order.
+void spatial_index_query(SpatialIndex& si, glm::vec2 min, glm::vec2 max,
+                         std::vector<uint32_t>& result) {
+    if (si.root == SPATIAL_INDEX_NONE) return;
+
+    si.stack.clear();
+    si.stack.push_back(si.root);
+    while (!si.stack.empty()) {
+        const SpatialNode& node = si.nodes[si.stack.back()];
+        si.stack.pop_back();
+
+        float loose = node.half_size * 2.0f;
+        if (node.count == 0 || node.center.x - loose > max.x || node.center.x + loose < min.x ||
+            node.center.y - loose > max.y || node.center.y + loose < min.y) {
+            continue;
+        }
+        for (uint32_t id : node.items) {
+            const SpatialItem& item = si.items[id];
+            if (item.min.x <= max.x && item.max.x >= min.x && item.min.y <= max.y &&
+                item.max.y >= min.y) {
+                result.push_back(id);
+            }
+        }
+        for (uint32_t child : node.children) {
+            if (child != SPATIAL_INDEX_NONE) si.stack.push_back(child);
+        }
+    }
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "mipmaps.h"
+#include "texture_pages.h"
+
+// Decoded images as the mip chains uploaded to the texture pages, RGBA8 or already converted for
+// them, one file per image named by the content hash of its encoded file. Reopening a board reads
+// them back instead of decoding. Files are touched when read, the least recently used go first
+// once the cache is over budget.
+#define TEXTURE_CACHE_MAGIC "BOARDTEX"
+#define TEXTURE_CACHE_VERSION 4
+#define TEXTURE_CACHE_DEFAULT_BUDGET_MB 2048
+// Temporary files older than this were left by a crash, not by another instance still writing.
+#define TEXTURE_CACHE_STALE_TEMP_MINUTES 10
+
+struct TextureCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t level_count;
+    // First level of the chain, and the image as decoded before it was reduced.
+    uint32_t width;
+    uint32_t height;
+    uint32_t full_width;
+    uint32_t full_height;
+    uint32_t color;
+    // bgfx::TextureFormat of the levels. An image in another format than RGBA8 is stored as its
+    // texture_pages_prepare uploads one level after the other, RGBA8 as a plain mip chain.
+    uint32_t format;
+    // TextureCompressionPreset the image was loaded with, RGBA8 may be what it fell back to.
+    uint32_t preset;
+    // TextureChannels the format was chosen for.
+    uint32_t channels;
+    uint64_t data_size;
+};
+static_assert(sizeof(TextureCacheHeader) == 56, "texture cache header layout changed");
+
+// Shared by the loader threads. A cache without a directory is disabled.
+struct TextureCache {
+    std::string directory;
+    uint64_t budget_bytes = uint64_t(TEXTURE_CACHE_DEFAULT_BUDGET_MB) << 20;
+    std::atomic<uint64_t> total_bytes{0};
+    // Set while one thread trims, the others carry on.
+    std::atomic<bool> trimming{false};
+    std::atomic<uint32_t> next_temp{0};
+};
+
+// BOARDTHING_CACHE_DIR, or the platform's per-user cache directory.
+std::string texture_cache_default_directory() {
+    namespace fs = std::filesystem;
+    if (const char* dir = getenv("BOARDTHING_CACHE_DIR")) return dir;
+#if PLATFORM_WINDOWS
+    if (const char* dir = getenv("LOCALAPPDATA")) return (fs::path(dir) / "boardthing").string();
+#else
+    if (const char* dir = getenv("XDG_CACHE_HOME")) return (fs::path(dir) / "boardthing").string();
+    if (const char* dir = getenv("HOME")) return (fs::path(dir) / ".cache/boardthing").string();
+#endif
+    return "";
+}
+
+// Full resolution and reduced decodes of the same file are cached apart.
+std::string texture_cache_path(const TextureCache& cache, uint64_t hash, bool full_resolution) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx%s.tex", (unsigned long long)hash,
+             full_resolution ? "-full" : "");
+    return (std::filesystem::path(cache.directory) / name).string();
+}
+
+// Deletes the least recently used files until the cache holds at most target_bytes.
+void texture_cache_trim(TextureCache& cache, uint64_t target_bytes) {
+    namespace fs = std::filesystem;
+    struct CacheFile {
+        fs::path path;
+        fs::file_time_type used;
+        uint64_t size;
+    };
+    std::vector<CacheFile> files;
+    uint64_t total = 0;
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(cache.directory, error)) {
+        if (entry.path().extension() != ".tex") continue;
+        CacheFile file = {entry.path(), entry.last_write_time(error), entry.file_size(error)};
+        if (error) continue;
+        files.push_back(file);
+        total += file.size;
+    }
+    std::sort(files.begin(), files.end(),
+              [](const CacheFile& a, const CacheFile& b) { return a.used < b.used; });
+    for (const CacheFile& file : files) {
+        if (total <= target_bytes) break;
+        if (fs::remove(file.path, error)) total -= file.size;
+    }
+    cache.total_bytes = total;
+}
+
+// Deletes the temporary files of writes that never finished, trimming only counts .tex files.
+void texture_cache_remove_stale_temps(const TextureCache& cache) {
+    namespace fs = std::filesystem;
+    fs::file_time_type stale =
+        fs::file_time_type::clock::now() - std::chrono::minutes(TEXTURE_CACHE_STALE_TEMP_MINUTES);
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(cache.directory, error)) {
+        if (entry.path().extension() != ".tmp") continue;
+        fs::file_time_type written = entry.last_write_time(error);
+        if (!error && written < stale) fs::remove(entry.path(), error);
+    }
+}
+
+// Creates the directory if needed, clears out unfinished writes and brings the cache under
+// budget. Leaves the cache disabled when the directory can't be created.
+void texture_cache_open(TextureCache& cache, const std::string& directory) {
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (directory.empty() || !std::filesystem::is_directory(directory, error)) {
+        printf("[error] couldn't create texture cache %s, images are always decoded\n",
+               directory.c_str());
+        return;
+    }
+    cache.directory = directory;
+    texture_cache_remove_stale_temps(cache);
+    texture_cache_trim(cache, cache.budget_bytes);
+}
+
+// Reads a cached chain straight into mips, or into uploads when it isn't RGBA8, no decoding.
+// False on a miss.
+bool texture_cache_read(TextureCache& cache, uint64_t hash, bool full_resolution,
+                        TextureCacheHeader& header, std::vector<uint8_t>& mips,
+                        std::vector<size_t>& mip_offsets, std::vector<TextureUpload>& uploads) {
+    if (cache.directory.empty()) return false;
+    std::string path = texture_cache_path(cache, hash, full_resolution);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == TEXTURE_CACHE_VERSION && header.width > 0 && header.height > 0 &&
+                 header.level_count == uint32_t(mip_level_count(header.width, header.height)) &&
+                 header.format < bgfx::TextureFormat::Count;
+    auto format = bgfx::TextureFormat::Enum(valid ? header.format : 0);
+    if (valid && format != bgfx::TextureFormat::RGBA8) {
+        valid = texture_format_level_bytes(format, 1, 1) > 0;
+        size_t total = 0;
+        uploads.resize(header.level_count);
+        for (uint32_t level = 0; level < header.level_count; level++) {
+            TextureUpload& upload = uploads[level];
+            upload.format = format;
+            upload.width = mip_level_size(header.width, level);
+            upload.height = mip_level_size(header.height, level);
+            total += texture_pages_layout(upload);
+        }
+        valid = valid && header.data_size == total;
+        for (size_t level = 0; valid && level < uploads.size(); level++) {
+            TextureUpload& upload = uploads[level];
+            upload.data.resize(texture_pages_layout(upload));
+            valid = fread(upload.data.data(), 1, upload.data.size(), file) == upload.data.size();
+        }
+        if (!valid) uploads.clear();
+    } else if (valid) {
+        size_t total = 0;
+        mip_offsets.resize(header.level_count);
+        for (uint32_t level = 0; level < header.level_count; level++) {
+            mip_offsets[level] = total;
+            total += size_t(mip_level_size(header.width, level)) *
+                     mip_level_size(header.height, level) * 4;
+        }
+        valid = header.data_size == total;
+        if (valid) {
+            mips.resize(total);
+            valid = fread(mips.data(), 1, total, file) == total;
+        }
+    }
+    fclose(file);
+    if (!valid) {
+        remove(path.c_str());
+        return false;
+    }
+    std::error_code error;
+    // Touched as the most recently used.
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return true;
+}
+
+// Stores uploads when there are any, mips otherwise.
+void texture_cache_write(TextureCache& cache, uint64_t hash, bool full_resolution,
+                         const TextureCacheHeader& fields, const std::vector<uint8_t>& mips,
+                         const std::vector<TextureUpload>& uploads) {
+    if (cache.directory.empty()) return;
+    TextureCacheHeader header = fields;
+    memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = TEXTURE_CACHE_VERSION;
+    header.format = uploads.empty() ? uint32_t(bgfx::TextureFormat::RGBA8) : uploads[0].format;
+    header.data_size = mips.size();
+    if (!uploads.empty()) {
+        header.data_size = 0;
+        for (const TextureUpload& upload : uploads) header.data_size += upload.data.size();
+    }
+
+    // Two threads may write the same image, each goes through a temporary file of its own.
+    std::string path = texture_cache_path(cache, hash, full_resolution);
+    std::string temp_path = path + "." + std::to_string(cache.next_temp++) + ".tmp";
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    bool written = file && fwrite(&header, sizeof(header), 1, file) == 1;
+    if (uploads.empty()) {
+        written = written && fwrite(mips.data(), 1, mips.size(), file) == mips.size();
+    }
+    for (const TextureUpload& upload : uploads) {
+        written = written &&
+                  fwrite(upload.data.data(), 1, upload.data.size(), file) == upload.data.size();
+    }
+    if (file) written = fclose(file) == 0 && written;
+    std::error_code error;
+    if (written) std::filesystem::rename(temp_path, path, error);
+    if (!written || error) {
+        remove(temp_path.c_str());
+        return;
+    }
+
+    uint64_t size = sizeof(header) + header.data_size;
+    // Trimmed to three quarters of the budget at once, so a full cache doesn't rescan on every
+    // write.
+    if (cache.total_bytes.fetch_add(size) + size > cache.budget_bytes &&
+        !cache.trimming.exchange(true)) {
+        texture_cache_trim(cache, cache.budget_bytes * 3 / 4);
+        cache.trimming = false;
+    }
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+#include <bimg/encode.h>
+#include <bx/allocator.h>
+#include <bx/error.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+// Images go into the texture pages in a format that fits the channels they use: gray images in one
+// or two channels, opaque ones without alpha, and block-compressed, 4 to 8 times smaller than
+// RGBA8, unless compression is off. The loader's workers encode them, a format the GPU can't
+// sample falls back to the uncompressed one for the same channels, and that to RGBA8.
+enum TextureCompressionPreset : uint32_t {
+    TEXTURE_COMPRESSION_OFF,
+    // BC1/BC3/BC4/BC5 or ETC2, picked for encoding speed or quality.
+    TEXTURE_COMPRESSION_FAST,
+    TEXTURE_COMPRESSION_BALANCED,
+    // BC7 for every colour image on desktop.
+    TEXTURE_COMPRESSION_BEST,
+    TEXTURE_COMPRESSION_PRESET_COUNT,
+};
+#define TEXTURE_COMPRESSION_DEFAULT_PRESET TEXTURE_COMPRESSION_FAST
+
+// The channels an image actually uses.
+enum TextureChannels {
+    TEXTURE_CHANNELS_RGB,
+    TEXTURE_CHANNELS_RGBA,
+    TEXTURE_CHANNELS_GRAY,
+    TEXTURE_CHANNELS_GRAY_ALPHA,
+    TEXTURE_CHANNELS_COUNT,
+};
+
+// How the quad shader reads a page, sent along with its size. Gray images keep gray in the first
+// channel and alpha in the second.
+enum TextureSwizzle {
+    TEXTURE_SWIZZLE_RGBA,
+    TEXTURE_SWIZZLE_GRAY,
+    TEXTURE_SWIZZLE_GRAY_ALPHA,
+};
+
+struct TextureCompression {
+    TextureCompressionPreset preset = TEXTURE_COMPRESSION_OFF;
+    // Per TextureChannels, and the uncompressed format used where the encoder fails.
+    bgfx::TextureFormat::Enum formats[TEXTURE_CHANNELS_COUNT] = {
+        bgfx::TextureFormat::RGBA8, bgfx::TextureFormat::RGBA8, bgfx::TextureFormat::RGBA8,
+        bgfx::TextureFormat::RGBA8};
+    bgfx::TextureFormat::Enum lossless_formats[TEXTURE_CHANNELS_COUNT] = {
+        bgfx::TextureFormat::RGBA8, bgfx::TextureFormat::RGBA8, bgfx::TextureFormat::RGBA8,
+        bgfx::TextureFormat::RGBA8};
+    bimg::Quality::Enum quality = bimg::Quality::Default;
+};
+
+const char* const texture_compression_preset_names[TEXTURE_COMPRESSION_PRESET_COUNT] = {
+    "off", "fast", "balanced", "best"};
+
+// Formats for a preset, within what the GPU can sample. Has to run after bgfx::init.
+TextureCompression texture_compression_choose(TextureCompressionPreset preset) {
+    const uint16_t* caps = bgfx::getCaps()->formats;
+    auto supported = [&](bgfx::TextureFormat::Enum format) {
+        return (caps[format] & BGFX_CAPS_FORMAT_TEXTURE_2D) != 0;
+    };
+    // bgfx expands RGB8 to RGBA8 behind our back on some backends, nothing would be saved.
+    auto native = [&](bgfx::TextureFormat::Enum format, bgfx::TextureFormat::Enum fallback) {
+        return supported(format) && !(caps[format] & BGFX_CAPS_FORMAT_TEXTURE_2D_EMULATED)
+                   ? format
+                   : fallback;
+    };
+
+    TextureCompression compression = {.preset = preset};
+    bgfx::TextureFormat::Enum* lossless = compression.lossless_formats;
+    lossless[TEXTURE_CHANNELS_RGB] = native(bgfx::TextureFormat::RGB8, bgfx::TextureFormat::RGBA8);
+    lossless[TEXTURE_CHANNELS_GRAY] = native(bgfx::TextureFormat::R8, bgfx::TextureFormat::RGBA8);
+    lossless[TEXTURE_CHANNELS_GRAY_ALPHA] =
+        native(bgfx::TextureFormat::RG8, bgfx::TextureFormat::RGBA8);
+    memcpy(compression.formats, lossless, sizeof(compression.formats));
+    if (preset == TEXTURE_COMPRESSION_OFF) return compression;
+
+    bgfx::TextureFormat::Enum* formats = compression.formats;
+#ifdef EMSCRIPTEN
+    // WebGL2 has no single or two channel block format bgfx knows, gray images stay uncompressed.
+    formats[TEXTURE_CHANNELS_RGB] = bgfx::TextureFormat::ETC2;
+    formats[TEXTURE_CHANNELS_RGBA] = bgfx::TextureFormat::ETC2A;
+#else
+    bool best = preset == TEXTURE_COMPRESSION_BEST;
+    formats[TEXTURE_CHANNELS_RGB] = best ? bgfx::TextureFormat::BC7 : bgfx::TextureFormat::BC1;
+    formats[TEXTURE_CHANNELS_RGBA] = best ? bgfx::TextureFormat::BC7 : bgfx::TextureFormat::BC3;
+    formats[TEXTURE_CHANNELS_GRAY] = bgfx::TextureFormat::BC4;
+    formats[TEXTURE_CHANNELS_GRAY_ALPHA] = bgfx::TextureFormat::BC5;
+#endif
+    for (int channels = 0; channels < TEXTURE_CHANNELS_COUNT; channels++) {
+        if (!supported(formats[channels])) formats[channels] = lossless[channels];
+    }
+    compression.quality = preset == TEXTURE_COMPRESSION_FAST   ? bimg::Quality::Fastest
+                          : preset == TEXTURE_COMPRESSION_BEST ? bimg::Quality::Highest
+                                                               : bimg::Quality::Default;
+    return compression;
+}
+
+// Whether an image using channels, encoded to format under preset, is what compression encodes it
+// to now. The lossless fallback only counts for the same preset, another's encoder may not fail.
+bool texture_compression_uses(const TextureCompression& compression, TextureChannels channels,
+                              bgfx::TextureFormat::Enum format, uint32_t preset) {
+    return format == compression.formats[channels] ||
+           (preset == compression.preset && format == compression.lossless_formats[channels]);
+}
+
+// Bytes per 4x4 block, 0 for formats that aren't block-compressed.
+int texture_format_block_bytes(bgfx::TextureFormat::Enum format) {
+    switch (format) {
+    case bgfx::TextureFormat::BC1:
+    case bgfx::TextureFormat::BC4:
+    case bgfx::TextureFormat::ETC2:
+        return 8;
+    case bgfx::TextureFormat::BC3:
+    case bgfx::TextureFormat::BC5:
+    case bgfx::TextureFormat::BC7:
+    case bgfx::TextureFormat::ETC2A:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+// Bytes per pixel, 0 for block-compressed formats.
+int texture_format_pixel_bytes(bgfx::TextureFormat::Enum format) {
+    switch (format) {
+    case bgfx::TextureFormat::R8:
+        return 1;
+    case bgfx::TextureFormat::RG8:
+        return 2;
+    case bgfx::TextureFormat::RGB8:
+        return 3;
+    case bgfx::TextureFormat::RGBA8:
+        return 4;
+    default:
+        return 0;
+    }
+}
+
+// 0 for a format images are never stored in.
+size_t texture_format_level_bytes(bgfx::TextureFormat::Enum format, int width, int height) {
+    int block_bytes = texture_format_block_bytes(format);
+    if (block_bytes == 0) return size_t(width) * height * texture_format_pixel_bytes(format);
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+}
+
+TextureSwizzle texture_format_swizzle(bgfx::TextureFormat::Enum format) {
+    switch (format) {
+    case bgfx::TextureFormat::R8:
+    case bgfx::TextureFormat::BC4:
+        return TEXTURE_SWIZZLE_GRAY;
+    case bgfx::TextureFormat::RG8:
+    case bgfx::TextureFormat::BC5:
+        return TEXTURE_SWIZZLE_GRAY_ALPHA;
+    default:
+        return TEXTURE_SWIZZLE_RGBA;
+    }
+}
+
+// Copies an RGBA8 image into a larger one at (pad, pad), the edge pixels replicated out to its
+// borders.
+void texture_pad_rgba8(const uint8_t* pixels, int width, int height, int pad, int padded_width,
+                       int padded_height, std::vector<uint8_t>& padded) {
+    padded.resize(size_t(padded_width) * padded_height * 4);
+    for (int y = 0; y < padded_height; y++) {
+        int src_y = std::clamp(y - pad, 0, height - 1);
+        const uint8_t* src_row = pixels + size_t(src_y) * width * 4;
+        uint8_t* dst_row = padded.data() + size_t(y) * padded_width * 4;
+        for (int x = 0; x < pad; x++) {
+            memcpy(dst_row + x * 4, src_row, 4);
+        }
+        memcpy(dst_row + pad * 4, src_row, size_t(width) * 4);
+        for (int x = pad + width; x < padded_width; x++) {
+            memcpy(dst_row + x * 4, src_row + (width - 1) * 4, 4);
+        }
+    }
+}
+
+// Which channels an RGBA8 image uses. channels is the count it was decoded from, what that count
+// doesn't settle is checked pixel by pixel.
+TextureChannels texture_channels(const uint8_t* pixels, int width, int height, int channels) {
+    bool check_gray = channels > 2;
+    bool check_alpha = channels == 2 || channels == 4;
+    bool gray = true;
+    bool opaque = true;
+    size_t count = size_t(width) * height;
+    for (size_t i = 0; i < count && ((check_gray && gray) || (check_alpha && opaque)); i++) {
+        const uint8_t* pixel = pixels + i * 4;
+        if (check_gray && (pixel[0] != pixel[1] || pixel[0] != pixel[2])) gray = false;
+        if (check_alpha && pixel[3] != 255) opaque = false;
+    }
+    if (gray) return opaque ? TEXTURE_CHANNELS_GRAY : TEXTURE_CHANNELS_GRAY_ALPHA;
+    return opaque ? TEXTURE_CHANNELS_RGB : TEXTURE_CHANNELS_RGBA;
+}
+
+// Converts an RGBA8 image into texture_format_level_bytes(format, width, height) bytes at dst, the
+// channels the format keeps or its blocks. A side that isn't a multiple of the block size is
+// padded with its edge. Safe to call from any thread, false when the encoder can't produce the
+// format.
+bool texture_encode(bgfx::TextureFormat::Enum format, bimg::Quality::Enum quality,
+                    const uint8_t* pixels, int width, int height, uint8_t* dst,
+                    std::vector<uint8_t>& scratch) {
+    size_t count = size_t(width) * height;
+    switch (format) {
+    case bgfx::TextureFormat::R8:
+        for (size_t i = 0; i < count; i++) dst[i] = pixels[i * 4];
+        return true;
+    case bgfx::TextureFormat::RG8:
+        for (size_t i = 0; i < count; i++) {
+            dst[i * 2] = pixels[i * 4];
+            dst[i * 2 + 1] = pixels[i * 4 + 3];
+        }
+        return true;
+    case bgfx::TextureFormat::RGB8:
+        for (size_t i = 0; i < count; i++) memcpy(dst + i * 3, pixels + i * 4, 3);
+        return true;
+    case bgfx::TextureFormat::RGBA8:
+        memcpy(dst, pixels, count * 4);
+        return true;
+    default:
+        break;
+    }
+
+    int block_width = (width + 3) / 4 * 4;
+    int block_height = (height + 3) / 4 * 4;
+    const uint8_t* src = pixels;
+    if (block_width != width || block_height != height) {
+        texture_pad_rgba8(pixels, width, height, 0, block_width, block_height, scratch);
+        src = scratch.data();
+    }
+    // BC5 encodes the first two channels, gray and alpha.
+    if (format == bgfx::TextureFormat::BC5) {
+        if (src != scratch.data()) scratch.assign(pixels, pixels + count * 4);
+        for (size_t i = 0; i < size_t(block_width) * block_height; i++) {
+            scratch[i * 4 + 1] = scratch[i * 4 + 3];
+        }
+        src = scratch.data();
+    }
+    bx::DefaultAllocator allocator;
+    bx::Error error;
+    bimg::imageEncodeFromRgba8(&allocator, dst, src, uint32_t(block_width),
+                               uint32_t(block_height), 1, bimg::TextureFormat::Enum(format),
+                               quality, &error);
+    return error.isOk();
+}
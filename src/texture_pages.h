@@ -0,0 +1,481 @@
+#pragma once
+
+#include <bgfx/bgfx.h>
+#include <string.h>
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "mipmaps.h"
+#include "texture_compression.h"
+
+#define TEXTURE_PAGE_SIZE 2048
+#define TEXTURE_PAGE_PADDING 2
+// Shared pages only fill this many mip levels. Every padded image is aligned to the texel size of
+// the last one (16px) so no filtered texel up to that level mixes two images.
+#define TEXTURE_PAGE_MIP_LEVELS 5
+#define TEXTURE_PAGE_ALIGN (1 << (TEXTURE_PAGE_MIP_LEVELS - 1))
+// Shared pages of block-compressed images stop at the last level the alignment above still puts
+// on 4x4 block boundaries.
+#define TEXTURE_PAGE_COMPRESSED_MIP_LEVELS (TEXTURE_PAGE_MIP_LEVELS - 2)
+#define TEXTURE_PAGE_SAMPLER_FLAGS (BGFX_SAMPLER_U_CLAMP | BGFX_SAMPLER_V_CLAMP)
+// Images with a side above this get a page of their own instead of sharing an atlas page.
+#define TEXTURE_PAGE_MAX_SHARED_SIZE 512
+// A shared page whose live area drops under this fraction of its packed area gets repacked.
+#define TEXTURE_PAGE_REPACK_THRESHOLD 0.5f
+
+struct TextureSpan {
+    int x;
+    int width;
+    int entry;
+};
+
+struct TextureShelf {
+    int y;
+    int height;
+    std::vector<TextureSpan> spans;
+};
+
+struct TexturePage {
+    bgfx::TextureHandle texture_handle = BGFX_INVALID_HANDLE;
+    bgfx::TextureFormat::Enum format = bgfx::TextureFormat::RGBA8;
+    int width = 0;
+    int height = 0;
+    bool dedicated = false;
+    bool draining = false;
+    int mip_levels = 1;
+    std::vector<TextureShelf> shelves;
+    int live_area = 0;
+    int live_entries = 0;
+};
+
+// An image as it goes into a page: padded the way the page needs it, with the page's mip levels,
+// in the page's format. Compressed images are prepared off the main thread, the RGBA8 ones by the
+// pages while uploading.
+struct TextureUpload {
+    bgfx::TextureFormat::Enum format = bgfx::TextureFormat::RGBA8;
+    int width = 0;
+    int height = 0;
+    // The padded region that is uploaded, and where each of its levels starts in data.
+    int region_width = 0;
+    int region_height = 0;
+    std::vector<size_t> offsets;
+    std::vector<uint8_t> data;
+};
+
+struct TextureUploadScratch {
+    std::vector<uint8_t> padded;
+    std::vector<uint8_t> chain;
+    std::vector<size_t> chain_offsets;
+    std::vector<uint8_t> encode;
+};
+
+// Where an image lives inside its page, padding excluded. pixels, or upload for an image prepared
+// beforehand, is owned by the caller and has to outlive the entry, it is needed again when the
+// page gets repacked.
+struct TextureEntry {
+    int page = -1;
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    const uint8_t* pixels = nullptr;
+    const TextureUpload* upload = nullptr;
+    bool alive = false;
+};
+
+struct TexturePages {
+    std::vector<TexturePage> pages;
+    std::vector<int> free_pages;
+    std::vector<TextureEntry> entries;
+    std::vector<int> free_entries;
+    std::vector<int> pages_to_repack;
+    // Entries removed since the last texture_pages_update. Their region and page stay untouched
+    // until then, draws submitted earlier in the frame may still sample them.
+    std::vector<int> retired_entries;
+    // Bumped whenever an entry is placed, moved or removed, anything derived from entry pages and
+    // uv rects is stale once it changes.
+    uint32_t version = 0;
+    TextureUpload upload;
+    TextureUploadScratch upload_scratch;
+};
+
+// Size an image takes in a shared page once padded and aligned.
+int texture_pages_padded_size(int size) {
+    return (size + 2 * TEXTURE_PAGE_PADDING + TEXTURE_PAGE_ALIGN - 1) / TEXTURE_PAGE_ALIGN *
+           TEXTURE_PAGE_ALIGN;
+}
+
+bool texture_pages_dedicated(int width, int height) {
+    return width > TEXTURE_PAGE_MAX_SHARED_SIZE || height > TEXTURE_PAGE_MAX_SHARED_SIZE;
+}
+
+int texture_pages_mip_levels(bgfx::TextureFormat::Enum format, int width, int height,
+                             bool dedicated) {
+    if (dedicated) return mip_level_count(width, height);
+    return texture_format_block_bytes(format) > 0 ? TEXTURE_PAGE_COMPRESSED_MIP_LEVELS
+                                                  : TEXTURE_PAGE_MIP_LEVELS;
+}
+
+// Fills in the region and level offsets of an upload from its format and image size, returns the
+// size of its data. A dedicated page holds the image alone, only rounded up to whole blocks.
+size_t texture_pages_layout(TextureUpload& upload) {
+    bool dedicated = texture_pages_dedicated(upload.width, upload.height);
+    bool compressed = texture_format_block_bytes(upload.format) > 0;
+    if (!dedicated) {
+        upload.region_width = texture_pages_padded_size(upload.width);
+        upload.region_height = texture_pages_padded_size(upload.height);
+    } else if (compressed) {
+        upload.region_width = (upload.width + 3) / 4 * 4;
+        upload.region_height = (upload.height + 3) / 4 * 4;
+    } else {
+        upload.region_width = upload.width;
+        upload.region_height = upload.height;
+    }
+    int level_count = texture_pages_mip_levels(upload.format, upload.region_width,
+                                               upload.region_height, dedicated);
+    upload.offsets.resize(level_count);
+    size_t total = 0;
+    for (int level = 0; level < level_count; level++) {
+        upload.offsets[level] = total;
+        total += texture_format_level_bytes(upload.format,
+                                            mip_level_size(upload.region_width, level),
+                                            mip_level_size(upload.region_height, level));
+    }
+    return total;
+}
+
+// Builds what texture_pages_upload sends for an RGBA8 image, converted to format. In shared pages
+// it is surrounded by replicated edge pixels up to its aligned size, so filtering at any filled
+// level never picks up a neighbour. Touches no GPU state, safe to call from any thread. False when
+// the encoder can't produce the format.
+bool texture_pages_prepare(const uint8_t* pixels, int width, int height,
+                           bgfx::TextureFormat::Enum format, bimg::Quality::Enum quality,
+                           TextureUploadScratch& scratch, TextureUpload& upload) {
+    upload.format = format;
+    upload.width = width;
+    upload.height = height;
+    size_t size = texture_pages_layout(upload);
+    int region_width = upload.region_width;
+    int region_height = upload.region_height;
+    const uint8_t* region = pixels;
+    if (region_width != width || region_height != height) {
+        int pad = texture_pages_dedicated(width, height) ? 0 : TEXTURE_PAGE_PADDING;
+        texture_pad_rgba8(pixels, width, height, pad, region_width, region_height, scratch.padded);
+        region = scratch.padded.data();
+    }
+
+    int level_count = int(upload.offsets.size());
+    if (format == bgfx::TextureFormat::RGBA8) {
+        mip_build_chain(region, region_width, region_height, level_count, upload.data,
+                        scratch.chain_offsets);
+        return true;
+    }
+    mip_build_chain(region, region_width, region_height, level_count, scratch.chain,
+                    scratch.chain_offsets);
+    upload.data.resize(size);
+    for (int level = 0; level < level_count; level++) {
+        const uint8_t* level_pixels = scratch.chain.data() + scratch.chain_offsets[level];
+        uint8_t* dst = upload.data.data() + upload.offsets[level];
+        if (!texture_encode(format, quality, level_pixels, mip_level_size(region_width, level),
+                            mip_level_size(region_height, level), dst, scratch.encode)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int texture_pages_create_page(TexturePages& tp, int width, int height, bool dedicated,
+                              bgfx::TextureFormat::Enum format) {
+    int page_index;
+    if (!tp.free_pages.empty()) {
+        page_index = tp.free_pages.back();
+        tp.free_pages.pop_back();
+    } else {
+        page_index = int(tp.pages.size());
+        tp.pages.emplace_back();
+    }
+
+    TexturePage& page = tp.pages[page_index];
+    page = TexturePage{};
+    page.width = width;
+    page.height = height;
+    page.dedicated = dedicated;
+    page.format = format;
+    page.mip_levels = texture_pages_mip_levels(format, width, height, dedicated);
+    page.texture_handle = bgfx::createTexture2D(uint16_t(width), uint16_t(height), true, 1, format,
+                                                TEXTURE_PAGE_SAMPLER_FLAGS, NULL);
+    return page_index;
+}
+
+void texture_pages_destroy_page(TexturePages& tp, int page_index) {
+    TexturePage& page = tp.pages[page_index];
+    if (bgfx::isValid(page.texture_handle)) {
+        bgfx::destroy(page.texture_handle);
+    }
+    page = TexturePage{};
+    tp.free_pages.push_back(page_index);
+}
+
+// Uploads the image with its mip levels, prepared beforehand or built here for RGBA8 images.
+void texture_pages_upload(TexturePages& tp, const TextureEntry& entry) {
+    const TexturePage& page = tp.pages[entry.page];
+    const TextureUpload* upload = entry.upload;
+    if (!upload) {
+        texture_pages_prepare(entry.pixels, entry.width, entry.height, bgfx::TextureFormat::RGBA8,
+                              bimg::Quality::Default, tp.upload_scratch, tp.upload);
+        upload = &tp.upload;
+    }
+
+    int x = page.dedicated ? 0 : entry.x - TEXTURE_PAGE_PADDING;
+    int y = page.dedicated ? 0 : entry.y - TEXTURE_PAGE_PADDING;
+    for (int level = 0; level < page.mip_levels; level++) {
+        int level_width = mip_level_size(upload->region_width, level);
+        int level_height = mip_level_size(upload->region_height, level);
+        uint32_t size =
+            uint32_t(texture_format_level_bytes(upload->format, level_width, level_height));
+        bgfx::updateTexture2D(page.texture_handle, 0, uint8_t(level), uint16_t(x >> level),
+                              uint16_t(y >> level), uint16_t(level_width), uint16_t(level_height),
+                              bgfx::copy(upload->data.data() + upload->offsets[level], size));
+    }
+}
+
+// First fit over the shelves of a shared page. Returns false when the page has no room left.
+bool texture_pages_pack(TexturePages& tp, int page_index, int entry_index) {
+    TexturePage& page = tp.pages[page_index];
+    TextureEntry& entry = tp.entries[entry_index];
+    int width = texture_pages_padded_size(entry.width);
+    int height = texture_pages_padded_size(entry.height);
+
+    auto place = [&](TextureShelf& shelf, size_t span_index, int x) {
+        shelf.spans.insert(shelf.spans.begin() + span_index,
+                           TextureSpan{.x = x, .width = width, .entry = entry_index});
+        entry.page = page_index;
+        entry.x = x + TEXTURE_PAGE_PADDING;
+        entry.y = shelf.y + TEXTURE_PAGE_PADDING;
+        page.live_area += width * height;
+        page.live_entries++;
+    };
+
+    for (auto& shelf : page.shelves) {
+        // Don't let short images waste tall shelves unless the shelf is empty anyway.
+        if (shelf.height < height) continue;
+        if (!shelf.spans.empty() && shelf.height > height * 2) continue;
+
+        int x = 0;
+        for (size_t i = 0; i <= shelf.spans.size(); i++) {
+            int gap_end = i < shelf.spans.size() ? shelf.spans[i].x : page.width;
+            if (gap_end - x >= width) {
+                place(shelf, i, x);
+                return true;
+            }
+            if (i < shelf.spans.size()) x = shelf.spans[i].x + shelf.spans[i].width;
+        }
+    }
+
+    int top = page.shelves.empty() ? 0 : page.shelves.back().y + page.shelves.back().height;
+    if (top + height > page.height || width > page.width) {
+        return false;
+    }
+    page.shelves.push_back(TextureShelf{.y = top, .height = height});
+    place(page.shelves.back(), 0, 0);
+    return true;
+}
+
+void texture_pages_place(TexturePages& tp, int entry_index) {
+    TextureEntry& entry = tp.entries[entry_index];
+    tp.version++;
+    bgfx::TextureFormat::Enum format =
+        entry.upload ? entry.upload->format : bgfx::TextureFormat::RGBA8;
+
+    if (texture_pages_dedicated(entry.width, entry.height)) {
+        // Compressed pages are rounded up to whole blocks.
+        int width = entry.upload ? entry.upload->region_width : entry.width;
+        int height = entry.upload ? entry.upload->region_height : entry.height;
+        int page_index = texture_pages_create_page(tp, width, height, true, format);
+        TexturePage& page = tp.pages[page_index];
+        page.live_area = entry.width * entry.height;
+        page.live_entries = 1;
+        entry.page = page_index;
+        entry.x = 0;
+        entry.y = 0;
+        texture_pages_upload(tp, entry);
+        return;
+    }
+
+    for (int i = 0; i < int(tp.pages.size()); i++) {
+        TexturePage& page = tp.pages[i];
+        if (!bgfx::isValid(page.texture_handle) || page.dedicated || page.draining ||
+            page.format != format) {
+            continue;
+        }
+        if (texture_pages_pack(tp, i, entry_index)) {
+            texture_pages_upload(tp, tp.entries[entry_index]);
+            return;
+        }
+    }
+
+    int page_index =
+        texture_pages_create_page(tp, TEXTURE_PAGE_SIZE, TEXTURE_PAGE_SIZE, false, format);
+    texture_pages_pack(tp, page_index, entry_index);
+    texture_pages_upload(tp, tp.entries[entry_index]);
+}
+
+// Takes a page slot for an RGBA8 image, or for one prepared by texture_pages_prepare, and uploads
+// it. The returned entry id stays valid until texture_pages_remove, even if the image moves to
+// another page while repacking.
+int texture_pages_add(TexturePages& tp, const uint8_t* pixels, int width, int height,
+                      const TextureUpload* upload = nullptr) {
+    int entry_index;
+    if (!tp.free_entries.empty()) {
+        entry_index = tp.free_entries.back();
+        tp.free_entries.pop_back();
+    } else {
+        entry_index = int(tp.entries.size());
+        tp.entries.emplace_back();
+    }
+
+    tp.entries[entry_index] = TextureEntry{
+        .width = width, .height = height, .pixels = pixels, .upload = upload, .alive = true};
+    texture_pages_place(tp, entry_index);
+    return entry_index;
+}
+
+void texture_pages_unpack(TexturePages& tp, int entry_index) {
+    TextureEntry& entry = tp.entries[entry_index];
+    tp.version++;
+    TexturePage& page = tp.pages[entry.page];
+    page.live_entries--;
+
+    if (page.dedicated) {
+        texture_pages_destroy_page(tp, entry.page);
+        entry.page = -1;
+        return;
+    }
+
+    for (auto& shelf : page.shelves) {
+        if (entry.y - TEXTURE_PAGE_PADDING != shelf.y) continue;
+        for (size_t i = 0; i < shelf.spans.size(); i++) {
+            if (shelf.spans[i].entry != entry_index) continue;
+            page.live_area -= shelf.spans[i].width * texture_pages_padded_size(entry.height);
+            shelf.spans.erase(shelf.spans.begin() + i);
+            break;
+        }
+        break;
+    }
+    while (!page.shelves.empty() && page.shelves.back().spans.empty()) {
+        page.shelves.pop_back();
+    }
+    entry.page = -1;
+}
+
+// Frees a shared page that lost its last image, or queues it for repacking once it is mostly holes.
+void texture_pages_check_page(TexturePages& tp, int page_index) {
+    TexturePage& page = tp.pages[page_index];
+    if (page.draining) return;
+    if (page.live_entries == 0) {
+        texture_pages_destroy_page(tp, page_index);
+        return;
+    }
+
+    int packed_area = 0;
+    for (auto& shelf : page.shelves) packed_area += shelf.height * page.width;
+    if (page.live_area < packed_area * TEXTURE_PAGE_REPACK_THRESHOLD) {
+        page.draining = true;
+        tp.pages_to_repack.push_back(page_index);
+    }
+}
+
+void texture_pages_release(TexturePages& tp, int entry_index) {
+    TextureEntry& entry = tp.entries[entry_index];
+    int page_index = entry.page;
+    bool dedicated = tp.pages[page_index].dedicated;
+    texture_pages_unpack(tp, entry_index);
+    entry = TextureEntry{};
+    tp.free_entries.push_back(entry_index);
+
+    if (!dedicated) {
+        texture_pages_check_page(tp, page_index);
+    }
+}
+
+// O(1), the entry's pixels may be freed right after. Its region is reclaimed, and its page
+// destroyed if it was the last image on it, by the next texture_pages_update.
+void texture_pages_remove(TexturePages& tp, int entry_index) {
+    TextureEntry& entry = tp.entries[entry_index];
+    if (!entry.alive) return;
+
+    entry.alive = false;
+    entry.pixels = nullptr;
+    entry.upload = nullptr;
+    tp.retired_entries.push_back(entry_index);
+    tp.version++;
+}
+
+// Swaps the image behind an entry for one of another size, e.g. another mip level of it. The entry
+// id is kept, it may land in a different page.
+void texture_pages_resize(TexturePages& tp, int entry_index, const uint8_t* pixels, int width,
+                          int height, const TextureUpload* upload = nullptr) {
+    TextureEntry& entry = tp.entries[entry_index];
+    int page_index = entry.page;
+    bool dedicated = tp.pages[page_index].dedicated;
+    texture_pages_unpack(tp, entry_index);
+
+    entry.pixels = pixels;
+    entry.upload = upload;
+    entry.width = width;
+    entry.height = height;
+    texture_pages_place(tp, entry_index);
+
+    if (!dedicated) {
+        texture_pages_check_page(tp, page_index);
+    }
+}
+
+// Reclaims the entries removed last frame, then moves the images of at most one fragmented page
+// into the other pages, tallest first, and frees it. Called once per frame before any draw, so
+// deleting many quads never stalls a single frame on uploads.
+void texture_pages_update(TexturePages& tp) {
+    for (int entry_index : tp.retired_entries) {
+        texture_pages_release(tp, entry_index);
+    }
+    tp.retired_entries.clear();
+
+    if (tp.pages_to_repack.empty()) return;
+    int page_index = tp.pages_to_repack.back();
+    tp.pages_to_repack.pop_back();
+
+    std::vector<int> moved;
+    for (auto& shelf : tp.pages[page_index].shelves) {
+        for (auto& span : shelf.spans) moved.push_back(span.entry);
+    }
+    std::sort(moved.begin(), moved.end(),
+              [&](int a, int b) { return tp.entries[a].height > tp.entries[b].height; });
+
+    for (int entry_index : moved) {
+        texture_pages_unpack(tp, entry_index);
+        texture_pages_place(tp, entry_index);
+    }
+    texture_pages_destroy_page(tp, page_index);
+}
+
+bgfx::TextureHandle texture_pages_texture(const TexturePages& tp, int entry_index) {
+    return tp.pages[tp.entries[entry_index].page].texture_handle;
+}
+
+glm::vec4 texture_pages_uv_rect(const TexturePages& tp, int entry_index) {
+    const TextureEntry& entry = tp.entries[entry_index];
+    const TexturePage& page = tp.pages[entry.page];
+    return glm::vec4(float(entry.x) / page.width, float(entry.y) / page.height,
+                     float(entry.x + entry.width) / page.width,
+                     float(entry.y + entry.height) / page.height);
+}
+
+// Page size, the highest mip level that may be sampled and the TextureSwizzle of the page's
+// format, for the quad fragment shader.
+glm::vec4 texture_pages_sampling(const TexturePages& tp, int entry_index) {
+    const TexturePage& page = tp.pages[tp.entries[entry_index].page];
+    return glm::vec4(float(page.width), float(page.height), float(page.mip_levels - 1),
+                     float(texture_format_swizzle(page.format)));
+}
@@ -0,0 +1,568 @@
+#pragma once
+
+// Expects stb_image to be included already (misc.h does it along with its implementation).
+
+#include <limits.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "mipmaps.h"
+#include "row_decoders.h"
+#include "texture_pages.h"
+
+// Images with a side above this are split into a tile pyramid instead of one texture.
+#define TILED_IMAGE_MIN_SIZE 8192
+#define TILE_SIZE 256
+// Every tile is stored with one row/column of its neighbours around it so bilinear filtering is
+// continuous across tile seams.
+#define TILE_BORDER 1
+#define TILE_RECORD_SIZE ((TILE_SIZE + 2 * TILE_BORDER) * (TILE_SIZE + 2 * TILE_BORDER) * 4)
+#define TILED_IMAGES_DEFAULT_BUDGET_MB 256
+#define TILED_IMAGES_TILES_PER_FRAME 16
+
+// Hands out an image one RGBA8 row at a time, top row first. Binary PGM/PPM files, PNGs and
+// baseline JPEGs are streamed from disk, anything else goes through a single stb_image decode that
+// is freed once read.
+struct ImageRowReader {
+    FILE* file = nullptr;
+    int channels = 0;
+    PngRowDecoder* png = nullptr;
+    JpegRowDecoder* jpeg = nullptr;
+    uint8_t* decoded = nullptr;
+    int width = 0;
+    int height = 0;
+    int next_row = 0;
+    std::vector<uint8_t> raw_row;
+};
+
+int image_row_reader_pnm_int(FILE* file) {
+    int c = fgetc(file);
+    while (c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') c = fgetc(file);
+        } else if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            c = fgetc(file);
+        } else {
+            break;
+        }
+    }
+    int value = -1;
+    while (c >= '0' && c <= '9') {
+        value = (value < 0 ? 0 : value * 10) + (c - '0');
+        c = fgetc(file);
+    }
+    return value;
+}
+
+bool image_row_reader_open(ImageRowReader& reader, const char* path) {
+    reader = ImageRowReader{};
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    char magic[2] = {};
+    if (fread(magic, 1, 2, file) == 2 && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6')) {
+        int width = image_row_reader_pnm_int(file);
+        int height = image_row_reader_pnm_int(file);
+        int max_value = image_row_reader_pnm_int(file);
+        if (width > 0 && height > 0 && max_value > 0 && max_value < 256) {
+            reader.file = file;
+            reader.channels = magic[1] == '5' ? 1 : 3;
+            reader.width = width;
+            reader.height = height;
+            reader.raw_row.resize(size_t(width) * reader.channels);
+            return true;
+        }
+    }
+
+    rewind(file);
+    reader.png = new PngRowDecoder;
+    if (png_rows_open(*reader.png, file)) {
+        reader.file = file;
+        reader.width = reader.png->width;
+        reader.height = reader.png->height;
+        return true;
+    }
+    delete reader.png;
+    reader.png = nullptr;
+
+    rewind(file);
+    reader.jpeg = new JpegRowDecoder;
+    if (jpeg_rows_open_file(*reader.jpeg, file)) {
+        reader.file = file;
+        reader.width = reader.jpeg->width;
+        reader.height = reader.jpeg->height;
+        return true;
+    }
+    delete reader.jpeg;
+    reader.jpeg = nullptr;
+    fclose(file);
+
+    // The whole image has to fit one stb_image allocation, which is sized with an int.
+    int channels;
+    if (!stbi_info(path, &reader.width, &reader.height, &channels)) return false;
+    if (size_t(reader.width) * reader.height * 4 > size_t(INT_MAX)) {
+        printf("[error] %s is %dx%d, too large to decode other than as PNG or baseline JPEG\n",
+               path, reader.width, reader.height);
+        return false;
+    }
+
+    // Runs on the image loader's threads, which decode flipped otherwise.
+    stbi_set_flip_vertically_on_load_thread(false);
+    reader.decoded = stbi_load(path, &reader.width, &reader.height, &channels, 4);
+    stbi_set_flip_vertically_on_load_thread(true);
+    return reader.decoded != nullptr;
+}
+
+bool image_row_reader_read(ImageRowReader& reader, uint8_t* row) {
+    if (reader.next_row >= reader.height) return false;
+
+    if (reader.decoded) {
+        memcpy(row, reader.decoded + size_t(reader.next_row) * reader.width * 4,
+               size_t(reader.width) * 4);
+    } else if (reader.png) {
+        if (!png_rows_read(*reader.png, row)) return false;
+    } else if (reader.jpeg) {
+        if (!jpeg_rows_read(*reader.jpeg, row)) return false;
+    } else {
+        if (fread(reader.raw_row.data(), 1, reader.raw_row.size(), reader.file) !=
+            reader.raw_row.size()) {
+            return false;
+        }
+        for (int x = 0; x < reader.width; x++) {
+            const uint8_t* src = reader.raw_row.data() + size_t(x) * reader.channels;
+            row[x * 4 + 0] = src[0];
+            row[x * 4 + 1] = src[reader.channels == 3 ? 1 : 0];
+            row[x * 4 + 2] = src[reader.channels == 3 ? 2 : 0];
+            row[x * 4 + 3] = 255;
+        }
+    }
+    reader.next_row++;
+    return true;
+}
+
+void image_row_reader_close(ImageRowReader& reader) {
+    if (reader.file) fclose(reader.file);
+    delete reader.png;
+    delete reader.jpeg;
+    if (reader.decoded) stbi_image_free(reader.decoded);
+    reader = ImageRowReader{};
+}
+
+struct TiledLevel {
+    int width;
+    int height;
+    int tiles_x;
+    int tiles_y;
+    size_t first_tile;
+};
+
+struct TileSlot {
+    std::vector<uint8_t> pixels;
+    int texture_entry = -1;
+    uint32_t last_used_frame = 0;
+    uint32_t requested_frame = UINT32_MAX;
+};
+
+// Tile pyramid of one large image. Tiles live in a scratch file and only the ones in view are
+// loaded into the texture pages. The single tile of the coarsest level is always resident.
+struct TiledImage {
+    FILE* file = nullptr;
+    int width = 0;
+    int height = 0;
+    std::vector<TiledLevel> levels;
+    std::vector<TileSlot> tiles;
+    bool alive = false;
+};
+
+struct TileRef {
+    int image;
+    int tile;
+    int level;
+};
+
+struct TileDraw {
+    glm::vec4 local_rect;
+    glm::vec4 uv_rect;
+    int texture_entry;
+};
+
+struct TiledImages {
+    std::vector<TiledImage> images;
+    std::vector<int> free_images;
+    std::vector<TileRef> resident;
+    std::vector<TileRef> missing;
+    // Images removed since the last update, their tiles are released there.
+    std::vector<int> removed;
+    size_t budget_bytes = size_t(TILED_IMAGES_DEFAULT_BUDGET_MB) << 20;
+    size_t resident_bytes = 0;
+    uint32_t frame = 0;
+    bool pending = false;
+};
+
+// Releases a built image that never made it into TiledImages.
+void tiled_image_close(TiledImage& image) {
+    if (image.file) fclose(image.file);
+    image = TiledImage{};
+}
+
+bool tiled_images_seek(FILE* file, int64_t offset) {
+#if PLATFORM_WINDOWS
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+void tiled_level_tile_size(const TiledLevel& level, int tx, int ty, int& width, int& height) {
+    width = std::min(TILE_SIZE, level.width - tx * TILE_SIZE);
+    height = std::min(TILE_SIZE, level.height - ty * TILE_SIZE);
+}
+
+// One level of the pyramid while it is being built. Rows come in top to bottom, a band of
+// TILE_SIZE rows plus the border row above and below is kept and written out as tiles once the
+// row after it arrives. Every second row is downsampled into the next level.
+struct TileLevelBuilder {
+    TiledLevel level;
+    std::vector<uint8_t> band;
+    int band_index = 0;
+    int rows_received = 0;
+    std::vector<uint8_t> row_pair;
+    std::vector<uint8_t> half_row;
+};
+
+void tiled_builder_write_band(FILE* file, TileLevelBuilder& builder) {
+    const TiledLevel& level = builder.level;
+    size_t row_bytes = size_t(level.width) * 4;
+    std::vector<uint8_t> record;
+
+    for (int tx = 0; tx < level.tiles_x; tx++) {
+        int width, height;
+        tiled_level_tile_size(level, tx, builder.band_index, width, height);
+        int record_width = width + 2 * TILE_BORDER;
+        int record_height = height + 2 * TILE_BORDER;
+        record.resize(size_t(record_width) * record_height * 4);
+
+        // The band starts at the border row above, the last row repeats past the image bottom.
+        bool has_row_below = builder.band_index * TILE_SIZE + height < level.height;
+        int last_band_row = has_row_below ? height + 1 : height;
+        for (int r = 0; r < record_height; r++) {
+            int band_row = std::min(r, last_band_row);
+            const uint8_t* src = builder.band.data() + size_t(band_row) * row_bytes;
+            uint8_t* dst = record.data() + size_t(r) * record_width * 4;
+            for (int c = 0; c < record_width; c++) {
+                int x = glm::clamp(tx * TILE_SIZE - TILE_BORDER + c, 0, level.width - 1);
+                memcpy(dst + c * 4, src + size_t(x) * 4, 4);
+            }
+        }
+
+        size_t tile = level.first_tile + size_t(builder.band_index) * level.tiles_x + tx;
+        tiled_images_seek(file, int64_t(tile) * TILE_RECORD_SIZE);
+        fwrite(record.data(), 1, record.size(), file);
+    }
+}
+
+void tiled_builder_push_row(FILE* file, std::vector<TileLevelBuilder>& builders, int index,
+                            const uint8_t* row) {
+    TileLevelBuilder& builder = builders[index];
+    const TiledLevel& level = builder.level;
+    size_t row_bytes = size_t(level.width) * 4;
+    int y = builder.rows_received++;
+
+    int band_row = y - (builder.band_index * TILE_SIZE - TILE_BORDER);
+    memcpy(builder.band.data() + size_t(band_row) * row_bytes, row, row_bytes);
+    if (y == 0) {
+        memcpy(builder.band.data(), row, row_bytes);
+    }
+
+    bool last_row = y == level.height - 1;
+    while (builder.band_index * TILE_SIZE < level.height &&
+           (y >= (builder.band_index + 1) * TILE_SIZE || last_row)) {
+        tiled_builder_write_band(file, builder);
+        // The last content row and the row below become the border and first row of the next.
+        memmove(builder.band.data(), builder.band.data() + size_t(TILE_SIZE) * row_bytes,
+                2 * row_bytes);
+        builder.band_index++;
+        if (builder.band_index * TILE_SIZE > y) break;
+    }
+
+    if (index + 1 < int(builders.size())) {
+        memcpy(builder.row_pair.data() + (y & 1) * row_bytes, row, row_bytes);
+        // A single row level still has to feed the levels above it.
+        if (level.height == 1) {
+            memcpy(builder.row_pair.data() + row_bytes, row, row_bytes);
+        }
+        if ((y & 1) || level.height == 1) {
+            mip_downsample_rgba8(builder.row_pair.data(), level.width, 2,
+                                 builder.half_row.data());
+            tiled_builder_push_row(file, builders, index + 1, builder.half_row.data());
+        }
+    }
+}
+
+// Splits an image into a TILE_SIZE pyramid written to a scratch file, reading it one row at a
+// time. Memory use stays at a band of rows per level whatever the size of a streamed image. Takes
+// seconds for the largest images and touches nothing shared, the image loader's workers run it and
+// hand the result to tiled_images_add.
+bool tiled_image_build(TiledImage& image, const char* path) {
+    image = TiledImage{};
+    ImageRowReader reader;
+    if (!image_row_reader_open(reader, path)) return false;
+
+    image.file = tmpfile();
+    if (!image.file) {
+        image_row_reader_close(reader);
+        return false;
+    }
+    image.width = reader.width;
+    image.height = reader.height;
+
+    std::vector<TileLevelBuilder> builders;
+    size_t tile_count = 0;
+    for (int l = 0;; l++) {
+        TiledLevel level;
+        level.width = mip_level_size(image.width, l);
+        level.height = mip_level_size(image.height, l);
+        level.tiles_x = (level.width + TILE_SIZE - 1) / TILE_SIZE;
+        level.tiles_y = (level.height + TILE_SIZE - 1) / TILE_SIZE;
+        level.first_tile = tile_count;
+        tile_count += size_t(level.tiles_x) * level.tiles_y;
+        image.levels.push_back(level);
+
+        TileLevelBuilder builder;
+        builder.level = level;
+        builder.band.resize(size_t(level.width) * 4 * (TILE_SIZE + 2 * TILE_BORDER));
+        builder.row_pair.resize(size_t(level.width) * 4 * 2);
+        builder.half_row.resize(size_t(mip_level_size(level.width, 1)) * 4);
+        builders.push_back(std::move(builder));
+
+        if (level.tiles_x == 1 && level.tiles_y == 1) break;
+    }
+    image.tiles.resize(tile_count);
+
+    std::vector<uint8_t> row(size_t(image.width) * 4);
+    bool ok = true;
+    for (int y = 0; y < image.height && ok; y++) {
+        ok = image_row_reader_read(reader, row.data());
+        if (ok) tiled_builder_push_row(image.file, builders, 0, row.data());
+    }
+    image_row_reader_close(reader);
+    if (!ok) tiled_image_close(image);
+    return ok;
+}
+
+size_t tiled_images_tile_bytes(const TileSlot& slot) {
+    return slot.pixels.size() + slot.pixels.size() / 3;
+}
+
+void tiled_images_load_tile(TiledImages& ti, TexturePages& tp, TileRef ref) {
+    TiledImage& image = ti.images[ref.image];
+    const TiledLevel& level = image.levels[ref.level];
+    int index = int(ref.tile - level.first_tile);
+    int width, height;
+    tiled_level_tile_size(level, index % level.tiles_x, index / level.tiles_x, width, height);
+    width += 2 * TILE_BORDER;
+    height += 2 * TILE_BORDER;
+
+    TileSlot& slot = image.tiles[ref.tile];
+    slot.pixels.resize(size_t(width) * height * 4);
+    if (!tiled_images_seek(image.file, int64_t(ref.tile) * TILE_RECORD_SIZE) ||
+        fread(slot.pixels.data(), 1, slot.pixels.size(), image.file) != slot.pixels.size()) {
+        printf("[error] couldn't read tile %d of tiled image %d\n", ref.tile, ref.image);
+        slot.pixels = std::vector<uint8_t>();
+        return;
+    }
+    slot.texture_entry = texture_pages_add(tp, slot.pixels.data(), width, height);
+    slot.last_used_frame = ti.frame;
+    ti.resident_bytes += tiled_images_tile_bytes(slot);
+    // The coarsest tile is pinned, only the others are candidates for eviction.
+    if (ref.level < int(image.levels.size()) - 1) {
+        ti.resident.push_back(ref);
+    }
+}
+
+void tiled_images_unload_tile(TiledImages& ti, TexturePages& tp, TileRef ref) {
+    TileSlot& slot = ti.images[ref.image].tiles[ref.tile];
+    // A tile whose read failed never got an entry, nor counted as resident.
+    if (slot.texture_entry >= 0) {
+        texture_pages_remove(tp, slot.texture_entry);
+        ti.resident_bytes -= tiled_images_tile_bytes(slot);
+    }
+    slot.texture_entry = -1;
+    slot.pixels = std::vector<uint8_t>();
+}
+
+// Takes over an image tiled_image_build made and uploads its coarsest tile.
+int tiled_images_add(TiledImages& ti, TexturePages& tp, TiledImage& built) {
+    int image_index;
+    if (!ti.free_images.empty()) {
+        image_index = ti.free_images.back();
+        ti.free_images.pop_back();
+    } else {
+        image_index = int(ti.images.size());
+        ti.images.emplace_back();
+    }
+
+    TiledImage& image = ti.images[image_index];
+    image = std::move(built);
+    built = TiledImage{};
+    image.alive = true;
+
+    int top = int(image.levels.size()) - 1;
+    tiled_images_load_tile(ti, tp, TileRef{image_index, int(image.levels[top].first_tile), top});
+    return image_index;
+}
+
+// O(1), the tiles and the scratch file are released by the next tiled_images_update.
+void tiled_images_remove(TiledImages& ti, int image_index) {
+    TiledImage& image = ti.images[image_index];
+    if (!image.alive) return;
+
+    image.alive = false;
+    ti.removed.push_back(image_index);
+}
+
+void tiled_images_release_removed(TiledImages& ti, TexturePages& tp) {
+    size_t kept = 0;
+    for (TileRef ref : ti.resident) {
+        if (!ti.images[ref.image].alive) {
+            tiled_images_unload_tile(ti, tp, ref);
+        } else {
+            ti.resident[kept++] = ref;
+        }
+    }
+    ti.resident.resize(kept);
+
+    for (int image_index : ti.removed) {
+        TiledImage& image = ti.images[image_index];
+        int top = int(image.levels.size()) - 1;
+        tiled_images_unload_tile(ti, tp,
+                                 TileRef{image_index, int(image.levels[top].first_tile), top});
+        fclose(image.file);
+        image = TiledImage{};
+        ti.free_images.push_back(image_index);
+    }
+    ti.removed.clear();
+}
+
+// Lists the tiles covering the visible part of the image, given in quad-local [-1, 1] coordinates,
+// at the level matching texels_per_pixel. A tile that is not loaded yet is requested and drawn
+// from the closest coarser level that is.
+void tiled_images_collect(TiledImages& ti, const TexturePages& tp, int image_index,
+                          glm::vec2 visible_min, glm::vec2 visible_max, float texels_per_pixel,
+                          std::vector<TileDraw>& draws) {
+    TiledImage& image = ti.images[image_index];
+    int top = int(image.levels.size()) - 1;
+    int wanted = texels_per_pixel > 1.0f ? int(floorf(log2f(texels_per_pixel))) : 0;
+    wanted = glm::clamp(wanted, 0, top);
+    const TiledLevel& level = image.levels[wanted];
+
+    // Image space is top-down, quad-local y points up.
+    glm::vec2 uv_min = glm::clamp((visible_min + 1.0f) * 0.5f, glm::vec2(0.0f), glm::vec2(1.0f));
+    glm::vec2 uv_max = glm::clamp((visible_max + 1.0f) * 0.5f, glm::vec2(0.0f), glm::vec2(1.0f));
+    int tx0 = glm::min(int(uv_min.x * level.width) / TILE_SIZE, level.tiles_x - 1);
+    int tx1 = glm::min(int(uv_max.x * level.width) / TILE_SIZE, level.tiles_x - 1);
+    int ty0 = glm::min(int((1.0f - uv_max.y) * level.height) / TILE_SIZE, level.tiles_y - 1);
+    int ty1 = glm::min(int((1.0f - uv_min.y) * level.height) / TILE_SIZE, level.tiles_y - 1);
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            // Normalized image rectangle of the tile, top-down.
+            float x0 = float(tx * TILE_SIZE) / level.width;
+            float x1 = float(std::min(level.width, (tx + 1) * TILE_SIZE)) / level.width;
+            float y0 = float(ty * TILE_SIZE) / level.height;
+            float y1 = float(std::min(level.height, (ty + 1) * TILE_SIZE)) / level.height;
+
+            int l = wanted;
+            int tile = int(level.first_tile) + ty * level.tiles_x + tx;
+            if (image.tiles[tile].texture_entry < 0 &&
+                image.tiles[tile].requested_frame != ti.frame) {
+                image.tiles[tile].requested_frame = ti.frame;
+                ti.missing.push_back(TileRef{image_index, tile, wanted});
+            }
+            // Ancestors are found from the tile center, which can't round onto a neighbour.
+            float center_x = (x0 + x1) * 0.5f;
+            float center_y = (y0 + y1) * 0.5f;
+            while (l < top) {
+                const TiledLevel& candidate = image.levels[l];
+                int cx = std::min(int(center_x * candidate.width) / TILE_SIZE,
+                                  candidate.tiles_x - 1);
+                int cy = std::min(int(center_y * candidate.height) / TILE_SIZE,
+                                  candidate.tiles_y - 1);
+                tile = int(candidate.first_tile) + cy * candidate.tiles_x + cx;
+                if (image.tiles[tile].texture_entry >= 0) break;
+                l++;
+            }
+            if (l == top) tile = int(image.levels[top].first_tile);
+
+            TileSlot& slot = image.tiles[tile];
+            // Only left out when even the coarsest tile couldn't be read.
+            if (slot.texture_entry < 0) continue;
+            slot.last_used_frame = ti.frame;
+            const TiledLevel& source = image.levels[l];
+            int index = tile - int(source.first_tile);
+            float origin_x = float((index % source.tiles_x) * TILE_SIZE - TILE_BORDER);
+            float origin_y = float((index / source.tiles_x) * TILE_SIZE - TILE_BORDER);
+
+            const TextureEntry& entry = tp.entries[slot.texture_entry];
+            const TexturePage& page = tp.pages[entry.page];
+            auto u = [&](float x) {
+                return (entry.x + x * source.width - origin_x) / float(page.width);
+            };
+            auto v = [&](float y) {
+                return (entry.y + y * source.height - origin_y) / float(page.height);
+            };
+
+            draws.push_back(TileDraw{
+                .local_rect = glm::vec4(x0 * 2.0f - 1.0f, 1.0f - y1 * 2.0f, x1 * 2.0f - 1.0f,
+                                        1.0f - y0 * 2.0f),
+                .uv_rect = glm::vec4(u(x0), v(y1), u(x1), v(y0)),
+                .texture_entry = slot.texture_entry});
+        }
+    }
+}
+
+// Loads the tiles missed last frame, coarse levels first so the view sharpens progressively, and
+// evicts the least recently drawn tiles to stay within the budget.
+void tiled_images_update(TiledImages& ti, TexturePages& tp) {
+    ti.pending = false;
+    if (!ti.removed.empty()) {
+        tiled_images_release_removed(ti, tp);
+    }
+    std::sort(ti.missing.begin(), ti.missing.end(),
+              [](const TileRef& a, const TileRef& b) { return a.level > b.level; });
+    std::sort(ti.resident.begin(), ti.resident.end(), [&](const TileRef& a, const TileRef& b) {
+        return ti.images[a.image].tiles[a.tile].last_used_frame >
+               ti.images[b.image].tiles[b.tile].last_used_frame;
+    });
+
+    int loaded = 0;
+    for (TileRef ref : ti.missing) {
+        TiledImage& image = ti.images[ref.image];
+        if (!image.alive || image.tiles[ref.tile].texture_entry >= 0) continue;
+        if (loaded == TILED_IMAGES_TILES_PER_FRAME) {
+            ti.pending = true;
+            break;
+        }
+
+        while (ti.resident_bytes + TILE_RECORD_SIZE * 4 / 3 > ti.budget_bytes &&
+               !ti.resident.empty()) {
+            TileRef oldest = ti.resident.back();
+            TiledImage& owner = ti.images[oldest.image];
+            if (owner.tiles[oldest.tile].last_used_frame == ti.frame) break;
+            tiled_images_unload_tile(ti, tp, oldest);
+            ti.resident.pop_back();
+        }
+        if (ti.resident_bytes + TILE_RECORD_SIZE * 4 / 3 > ti.budget_bytes) break;
+
+        tiled_images_load_tile(ti, tp, ref);
+        loaded++;
+    }
+    ti.missing.clear();
+    ti.frame++;
+}
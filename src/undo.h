@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "slot_map.h"
+
+#define UNDO_DEFAULT_BUDGET_KB 1024
+// Pixels of deleted quads kept around so their delete can be undone, the oldest steps are
+// forgotten past this.
+#define UNDO_DEFAULT_PAYLOAD_BUDGET_MB 256
+
+enum UndoOp : uint8_t {
+    UNDO_MOVE,
+    UNDO_MIRROR,
+    UNDO_Z_ORDER,
+    UNDO_DELETE,
+};
+
+// One edit of one quad, as the delta needed to apply it either way. Entries pushed together share
+// a group and are undone and redone together, e.g. a drag of the whole selection. Pixels never go
+// in here: a deleted quad stays in its slot, hidden, for as long as its delete entry exists.
+struct UndoEntry {
+    Handle quad;
+    uint32_t group = 0;
+    UndoOp op;
+    // Mirror flags toggled by UNDO_MIRROR.
+    uint8_t mirror = 0;
+    // Position before and after an UNDO_MOVE.
+    glm::vec2 from;
+    glm::vec2 to;
+    // Quad directly below the quad before and after an UNDO_Z_ORDER, an invalid handle at the
+    // bottom. It may have been deleted for good by the time the entry is applied.
+    Handle below_before;
+    Handle below_after;
+};
+
+// Done entries followed by undone ones from the cursor on. Pushing drops what can no longer be
+// redone, going over budget drops the oldest whole groups into dropped for the caller to finalize.
+struct UndoJournal {
+    std::vector<UndoEntry> entries;
+    size_t cursor = 0;
+    uint32_t next_group = 1;
+    bool group_open = false;
+    size_t budget_bytes = size_t(UNDO_DEFAULT_BUDGET_KB) << 10;
+    std::vector<UndoEntry> dropped;
+};
+
+// Entries pushed until undo_end_group form one step.
+void undo_begin_group(UndoJournal& j) {
+    j.group_open = true;
+}
+
+void undo_end_group(UndoJournal& j) {
+    if (j.group_open) j.next_group++;
+    j.group_open = false;
+}
+
+size_t undo_journal_bytes(const UndoJournal& j) {
+    return j.entries.size() * sizeof(UndoEntry);
+}
+
+// Moves the oldest done group to dropped, returns false when nothing is left to drop. The last
+// done group, which may still be open, is never dropped: losing part of it would leave an undo step
+// that only reverts some of its quads.
+bool undo_drop_oldest(UndoJournal& j) {
+    if (j.cursor == 0) return false;
+    uint32_t group = j.entries[0].group;
+    if (group == j.entries[j.cursor - 1].group) return false;
+    size_t count = 0;
+    while (count < j.cursor && j.entries[count].group == group) count++;
+
+    j.dropped.insert(j.dropped.end(), j.entries.begin(), j.entries.begin() + count);
+    j.entries.erase(j.entries.begin(), j.entries.begin() + count);
+    j.cursor -= count;
+    return true;
+}
+
+void undo_push(UndoJournal& j, const UndoEntry& entry) {
+    // Undone entries are forgotten, the quads they touched are already back to before them.
+    j.entries.resize(j.cursor);
+    j.entries.push_back(entry);
+    j.entries.back().group = j.next_group;
+    j.cursor++;
+    if (!j.group_open) j.next_group++;
+
+    // Trimmed to three quarters of the budget at once, a full journal doesn't shift on every push.
+    // A single step bigger than that stays whole and overshoots the budget.
+    if (undo_journal_bytes(j) > j.budget_bytes) {
+        while (undo_journal_bytes(j) > j.budget_bytes * 3 / 4 && undo_drop_oldest(j)) {
+        }
+    }
+}
+
+// Range [begin, end) of the last done group, moving the cursor before it. Its entries have to be
+// reverted last to first.
+bool undo_step_back(UndoJournal& j, size_t& begin, size_t& end) {
+    if (j.cursor == 0) return false;
+    end = j.cursor;
+    begin = end - 1;
+    while (begin > 0 && j.entries[begin - 1].group == j.entries[end - 1].group) begin--;
+    j.cursor = begin;
+    return true;
+}
+
+// Range [begin, end) of the first undone group, moving the cursor past it. Its entries have to be
+// applied first to last.
+bool undo_step_forward(UndoJournal& j, size_t& begin, size_t& end) {
+    if (j.cursor == j.entries.size()) return false;
+    begin = j.cursor;
+    end = begin + 1;
+    while (end < j.entries.size() && j.entries[end].group == j.entries[begin].group) end++;
+    j.cursor = end;
+    return true;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#define Z_ORDER_NONE UINT32_MAX
+// Spacing of labels handed out at the ends and after a full relabel. Inserting between two
+// neighbours halves the gap, so about 32 insertions in the same spot fit before labels around it
+// have to be spread out again.
+#define Z_ORDER_LABEL_GAP (uint64_t(1) << 32)
+// An aligned range of 2^i labels is sparse enough to be spread out on its own while it holds at
+// most (2 / Z_ORDER_DENSITY)^i slots. Between 1 and 2, lower respreads wider ranges less often.
+#define Z_ORDER_DENSITY 1.5
+
+struct ZOrderNode {
+    uint32_t below = Z_ORDER_NONE;
+    uint32_t above = Z_ORDER_NONE;
+    uint64_t label = 0;
+    bool linked = false;
+};
+
+// Stacking order of slots as a doubly linked list, bottom to top. Each slot also carries a label
+// that grows towards the top, so comparing two slots is O(1) without walking the list. Moves only
+// touch the neighbours and pick a label between theirs. When two neighbours have no label left
+// between them, the labels of the smallest sparse enough range around them are spread out, which
+// keeps moves O(log n) amortised however often the same spot is hit.
+struct ZOrder {
+    std::vector<ZOrderNode> nodes;
+    uint32_t bottom = Z_ORDER_NONE;
+    uint32_t top = Z_ORDER_NONE;
+    uint32_t count = 0;
+};
+
+void z_order_relabel(ZOrder& z) {
+    uint64_t step = UINT64_MAX / (uint64_t(z.count) + 1);
+    if (step > Z_ORDER_LABEL_GAP) step = Z_ORDER_LABEL_GAP;
+    uint64_t label = (uint64_t(1) << 63) - step * (z.count / 2);
+    for (uint32_t slot = z.bottom; slot != Z_ORDER_NONE; slot = z.nodes[slot].above) {
+        z.nodes[slot].label = label;
+        label += step;
+    }
+}
+
+// Spreads out the labels of the smallest aligned label range around a slot just linked in that
+// is sparse enough to take it, walking out from the slot as the range doubles. Only a list too
+// dense for any range is relabelled whole.
+void z_order_relabel_around(ZOrder& z, uint32_t slot) {
+    const ZOrderNode& node = z.nodes[slot];
+    uint64_t anchor = z.nodes[node.below != Z_ORDER_NONE ? node.below : node.above].label;
+    uint32_t first = slot;
+    uint32_t last = slot;
+    uint64_t count = 1;
+    double limit = 1.0;
+
+    for (int bits = 1; bits < 64; bits++) {
+        limit *= 2.0 / Z_ORDER_DENSITY;
+        uint64_t size = uint64_t(1) << bits;
+        uint64_t base = anchor & ~(size - 1);
+        // Labels below base wrap around and compare as out of range too.
+        for (uint32_t below = z.nodes[first].below;
+             below != Z_ORDER_NONE && z.nodes[below].label - base < size;
+             below = z.nodes[below].below) {
+            first = below;
+            count++;
+        }
+        for (uint32_t above = z.nodes[last].above;
+             above != Z_ORDER_NONE && z.nodes[above].label - base < size;
+             above = z.nodes[above].above) {
+            last = above;
+            count++;
+        }
+        if (double(count) > limit || count >= size) continue;
+
+        uint64_t step = size / (count + 1);
+        uint64_t label = base + step;
+        for (uint32_t s = first;; s = z.nodes[s].above) {
+            z.nodes[s].label = label;
+            label += step;
+            if (s == last) break;
+        }
+        return;
+    }
+    z_order_relabel(z);
+}
+
+// Picks a label for a slot just linked in between its neighbours.
+void z_order_assign_label(ZOrder& z, uint32_t slot) {
+    ZOrderNode& node = z.nodes[slot];
+    bool has_below = node.below != Z_ORDER_NONE;
+    bool has_above = node.above != Z_ORDER_NONE;
+    uint64_t low = has_below ? z.nodes[node.below].label : 0;
+    uint64_t high = has_above ? z.nodes[node.above].label : UINT64_MAX;
+
+    if (!has_below && !has_above) {
+        node.label = uint64_t(1) << 63;
+    } else if (!has_above && high - low > Z_ORDER_LABEL_GAP) {
+        node.label = low + Z_ORDER_LABEL_GAP;
+    } else if (!has_below && high - low > Z_ORDER_LABEL_GAP) {
+        node.label = high - Z_ORDER_LABEL_GAP;
+    } else if (high - low >= 2) {
+        node.label = low + (high - low) / 2;
+    } else {
+        z_order_relabel_around(z, slot);
+    }
+}
+
+void z_order_unlink(ZOrder& z, uint32_t slot) {
+    if (slot >= z.nodes.size() || !z.nodes[slot].linked) return;
+    ZOrderNode& node = z.nodes[slot];
+
+    if (node.below != Z_ORDER_NONE) {
+        z.nodes[node.below].above = node.above;
+    } else {
+        z.bottom = node.above;
+    }
+    if (node.above != Z_ORDER_NONE) {
+        z.nodes[node.above].below = node.below;
+    } else {
+        z.top = node.below;
+    }
+    node = ZOrderNode{};
+    z.count--;
+}
+
+// Links slot right above below, or at the bottom when below is Z_ORDER_NONE. The slot is taken out
+// of its current position first.
+void z_order_insert_above(ZOrder& z, uint32_t slot, uint32_t below) {
+    if (slot >= z.nodes.size()) z.nodes.resize(slot + 1);
+    if (slot == below) return;
+    z_order_unlink(z, slot);
+
+    uint32_t above = below != Z_ORDER_NONE ? z.nodes[below].above : z.bottom;
+    ZOrderNode& node = z.nodes[slot];
+    node.below = below;
+    node.above = above;
+    node.linked = true;
+    if (below != Z_ORDER_NONE) {
+        z.nodes[below].above = slot;
+    } else {
+        z.bottom = slot;
+    }
+    if (above != Z_ORDER_NONE) {
+        z.nodes[above].below = slot;
+    } else {
+        z.top = slot;
+    }
+    z.count++;
+    z_order_assign_label(z, slot);
+}
+
+void z_order_insert_below(ZOrder& z, uint32_t slot, uint32_t above) {
+    if (slot == above) return;
+    z_order_unlink(z, slot);
+    z_order_insert_above(z, slot, above != Z_ORDER_NONE ? z.nodes[above].below : z.top);
+}
+
+void z_order_bring_to_front(ZOrder& z, uint32_t slot) {
+    if (slot == z.top) return;
+    z_order_unlink(z, slot);
+    z_order_insert_above(z, slot, z.top);
+}
+
+void z_order_send_to_back(ZOrder& z, uint32_t slot) {
+    if (slot == z.bottom) return;
+    z_order_unlink(z, slot);
+    z_order_insert_above(z, slot, Z_ORDER_NONE);
+}
+
+// True when a is stacked above b.
+bool z_order_is_above(const ZOrder& z, uint32_t a, uint32_t b) {
+    return z.nodes[a].label > z.nodes[b].label;
+}
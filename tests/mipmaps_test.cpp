@@ -0,0 +1,37 @@
+// Checks the SIMD 2x2 box filter against the scalar one on random images, including odd sizes and
+// single rows or columns where the SIMD loop hands over to the scalar tail.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "mipmaps.h"
+
+bool check_downsample(int width, int height) {
+    std::vector<uint8_t> src(size_t(width) * height * 4);
+    for (uint8_t& value : src) value = uint8_t(rand());
+
+    size_t dst_size = size_t(mip_level_size(width, 1)) * mip_level_size(height, 1) * 4;
+    std::vector<uint8_t> simd(dst_size);
+    std::vector<uint8_t> scalar(dst_size);
+    mip_downsample_rgba8(src.data(), width, height, simd.data(), true);
+    mip_downsample_rgba8(src.data(), width, height, scalar.data(), false);
+    if (memcmp(simd.data(), scalar.data(), dst_size) != 0) {
+        printf("[error] SIMD and scalar downsample differ at %dx%d\n", width, height);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    srand(1);
+    const int sizes[] = {1, 2, 3, 7, 8, 9, 16, 31, 64, 257};
+    bool passed = true;
+    for (int width : sizes) {
+        for (int height : sizes) passed &= check_downsample(width, height);
+    }
+    printf("%s\n", passed ? "passed" : "failed");
+    return passed ? 0 : 1;
+}